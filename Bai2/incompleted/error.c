@@ -6,10 +6,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "reader.h"
 #include "error.h"
 
-void error(ErrorCode err, int lineNo, int colNo)
+void error(ErrorCode err, int offset)
 {
+  int lineNo, colNo;
+
+  getPosition(offset, &lineNo, &colNo);
   switch (err)
   {
   case ERR_ENDOFCOMMENT:
@@ -23,6 +23,6 @@ typedef enum {
 #define ERM_ENDOFQUOTEEXPECTED "Closing double quote expected!"
 
 // Hàm thông báo lỗi
-void error(ErrorCode err, int lineNo, int colNo);
+void error(ErrorCode err, int offset);
 
 #endif
@@ -5,32 +5,97 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "reader.h"
 
-FILE *inputStream;
-int lineNo, colNo;
+#define READ_BLOCK_SIZE 65536
+
+/* The whole source is kept in memory; only the offset of the current
+   character is tracked while reading. Lines and columns are computed
+   from offsets when someone asks for them. */
+char *source = NULL;
+int sourceLength;
+int charNo;
 int currentChar;
 
+/* offsets of the '\n' characters, built on the first position lookup */
+int *newlines = NULL;
+int newlineCount = -1;
+
 int readChar(void) {
-  currentChar = getc(inputStream);
-  colNo ++;
-  if (currentChar == '\n') {
-    lineNo ++;
-    colNo = 0;
-  }
+  charNo ++;
+  currentChar = (charNo < sourceLength) ? (unsigned char) source[charNo] : EOF;
   return currentChar;
 }
 
 int openInputStream(char *fileName) {
-  inputStream = fopen(fileName, "rt");
-  if (inputStream == NULL)
+  FILE *f = fopen(fileName, "rb");
+  int capacity = READ_BLOCK_SIZE;
+  int n;
+
+  if (f == NULL)
     return IO_ERROR;
-  lineNo = 1;
-  colNo = 0;
+
+  source = (char*) malloc(capacity);
+  sourceLength = 0;
+  while ((n = fread(source + sourceLength, 1, capacity - sourceLength, f)) > 0) {
+    sourceLength += n;
+    if (sourceLength == capacity) {
+      capacity *= 2;
+      source = (char*) realloc(source, capacity);
+    }
+  }
+  fclose(f);
+
+  newlineCount = -1;
+  charNo = -1;
   readChar();
   return IO_SUCCESS;
 }
 
 void closeInputStream() {
-  fclose(inputStream);
+  free(source);
+  free(newlines);
+  source = NULL;
+  newlines = NULL;
+  newlineCount = -1;
+}
+
+void buildNewlineTable(void) {
+  int capacity = 256;
+  char *p = source;
+  char *end = source + sourceLength;
+
+  newlines = (int*) malloc(capacity * sizeof(int));
+  newlineCount = 0;
+  // memchr is vectorized by the C library, so this is a SIMD scan
+  while ((p = memchr(p, '\n', end - p)) != NULL) {
+    if (newlineCount == capacity) {
+      capacity *= 2;
+      newlines = (int*) realloc(newlines, capacity * sizeof(int));
+    }
+    newlines[newlineCount++] = p - source;
+    p ++;
+  }
+}
+
+/* A '\n' is reported at column 0 of the line after it, as the old
+   per-character counters did */
+void getPosition(int offset, int *lineNo, int *colNo) {
+  int lo = 0, hi;
+
+  if (newlineCount < 0)
+    buildNewlineTable();
+
+  // count the newlines at or before offset
+  hi = newlineCount;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (newlines[mid] <= offset) lo = mid + 1;
+    else hi = mid;
+  }
+
+  *lineNo = lo + 1;
+  *colNo = (lo == 0) ? offset + 1 : offset - newlines[lo - 1];
 }
@@ -13,5 +13,6 @@
 int readChar(void);
 int openInputStream(char *fileName);
 void closeInputStream(void);
+void getPosition(int offset, int *lineNo, int *colNo);
 
 #endif
@@ -14,8 +14,7 @@
 #include "token.h"
 #include "error.h"
 
-extern int lineNo;
-extern int colNo;
+extern int charNo;
 extern int currentChar;
 
 extern CharCode charCodes[];
@@ -49,7 +48,7 @@ void skipComment()
     readChar();
     if (currentChar == EOF)
     {
-      error(ERR_ENDOFCOMMENT, lineNo, colNo);
+      error(ERR_ENDOFCOMMENT, charNo);
       return;
     }
     else if (charCodes[currentChar] == CHAR_TIMES)
@@ -57,7 +56,7 @@ void skipComment()
       readChar();
       if (currentChar == EOF)
       {
-        error(ERR_ENDOFCOMMENT, lineNo, colNo);
+        error(ERR_ENDOFCOMMENT, charNo);
         return;
       }
       else if (charCodes[currentChar] == CHAR_RPAR)
@@ -75,7 +74,7 @@ void skipComment()
       readChar();
       if (currentChar == EOF)
       {
-        error(ERR_ENDOFCOMMENT, lineNo, colNo);
+        error(ERR_ENDOFCOMMENT, charNo);
         return;
       }
       else if (charCodes[currentChar] == CHAR_TIMES)
@@ -91,23 +90,24 @@ void skipComment()
 // -----------------------------------------------------
 
 Token* readIdentKeyword(void) {
-  Token *token = makeToken(TK_IDENT, lineNo, colNo);
+  Token *token = makeToken(TK_IDENT, charNo);
   int len = 0;
 
   while (currentChar != EOF && (charCodes[currentChar] == CHAR_LETTER || charCodes[currentChar] == CHAR_DIGIT)) {
     if (len >= MAX_IDENT_LEN) {
-      error(ERR_IDENTTOOLONG, token->lineNo, token->colNo);
+      error(ERR_IDENTTOOLONG, token->offset);
     }
-    token->string[len++] = currentChar;
+    len++;
     readChar();
   }
-  token->string[len] = '\0';
-  token->tokenType = checkKeyword(token->string);
+  // Token chỉ giữ vị trí và độ dài của tên trong văn bản nguồn
+  token->length = len;
+  token->tokenType = checkKeyword(tokenText(token), len);
   return token;
 }
 
 Token* readNumber(void) {
-  Token *token = makeToken(TK_NUMBER, lineNo, colNo);
+  Token *token = makeToken(TK_NUMBER, charNo);
   int len = 0;
   char numStr[20]; // Đủ lớn cho số nguyên
 
@@ -124,23 +124,23 @@ Token* readNumber(void) {
 }
 
 Token* readConstChar(void) {
-  Token *token = makeToken(TK_CHAR, lineNo, colNo);
+  Token *token = makeToken(TK_CHAR, charNo);
   readChar(); // Bỏ qua nháy đơn mở
 
   if (currentChar == EOF) {
-    error(ERR_INVALIDCHARCONSTANT, token->lineNo, token->colNo);
+    error(ERR_INVALIDCHARCONSTANT, token->offset);
   }
   
   if (currentChar == '\n') {
-      error(ERR_INVALIDCHARCONSTANT, token->lineNo, token->colNo);
+      error(ERR_INVALIDCHARCONSTANT, token->offset);
   }
 
-  token->string[0] = currentChar;
-  token->string[1] = '\0';
+  token->value = currentChar;
+  token->length = 3;
   readChar(); // Đọc ký tự của hằng
 
   if (currentChar == EOF || charCodes[currentChar] != CHAR_SINGLEQUOTE) {
-    error(ERR_INVALIDCHARCONSTANT, token->lineNo, token->colNo);
+    error(ERR_INVALIDCHARCONSTANT, token->offset);
   }
 
   readChar(); // Bỏ qua nháy đơn đóng
@@ -151,29 +151,30 @@ Token* readConstChar(void) {
 // HÀM MỚI: readStringConstant (Xử lý hằng xâu)
 // -----------------------------------------------------
 
+// Token xâu không sao chép nội dung: offset/length trỏ vào văn bản nguồn,
+// tính cả hai dấu nháy kép. Giá trị của xâu do decodeString() giải mã khi cần.
 Token* readStringConstant(void) {
-  Token *token = makeToken(TK_STRING, lineNo, colNo);
+  Token *token = makeToken(TK_STRING, charNo);
   int len = 0;
   
   readChar(); // Bỏ qua dấu nháy kép mở đầu (")
   
   while (currentChar != EOF) {
     
-    // 1. Gặp dấu nháy kép đóng
+    // 1. Gặp dấu nháy kép đóng; "" là dấu nháy kép nằm trong xâu
     if (charCodes[currentChar] == CHAR_DOUBLEQUOTE) {
-      token->string[len] = '\0';
       readChar(); // Bỏ qua dấu nháy kép đóng
-      return token;
+      if (currentChar == EOF || charCodes[currentChar] != CHAR_DOUBLEQUOTE) {
+        token->length = charNo - token->offset;
+        return token;
+      }
     }
     
     // 2. Gặp ký tự xuống dòng ('\n')
-    if (currentChar == '\n') {
-      // 2a. Tăng dòng và cột (vì vẫn là phần của mã nguồn)
-      lineNo++;
-      colNo = 0;
+    else if (currentChar == '\n') {
       readChar(); // Đọc ký tự tiếp theo sau \n
       
-      // 2b. Bỏ qua các ký tự trắng (space/tab) cho đến khi gặp ký tự khác trắng
+      // Bỏ qua các ký tự trắng (space/tab) cho đến khi gặp ký tự khác trắng
       // Lưu ý: Chỉ bỏ qua space/tab, không bỏ qua \n vì \n vừa được xử lý.
       while (currentChar != EOF && currentChar != '"' && (currentChar == ' ' || currentChar == '\t')) {
         readChar();
@@ -186,21 +187,18 @@ Token* readStringConstant(void) {
     
     // 3. Kiểm tra độ dài xâu
     if (len >= MAX_STRING_LENGTH) {
-      error(ERR_STRINGTOOLONG, token->lineNo, token->colNo);
+      error(ERR_STRINGTOOLONG, token->offset);
       // Dù báo lỗi, vẫn tiếp tục đọc cho đến khi đóng quote để tránh lỗi tiếp theo
     }
     
-    // 4. Thêm ký tự vào xâu
-    if (len < MAX_STRING_LENGTH) {
-        token->string[len] = currentChar;
-        len++;
-    }
+    // 4. Đếm ký tự của xâu, không sao chép
+    len++;
     readChar();
   }
   
   // Gặp EOF mà chưa có dấu nháy kép đóng
-  token->string[len] = '\0';
-  error(ERR_ENDOFQUOTEEXPECTED, token->lineNo, token->colNo);
+  token->length = charNo - token->offset;
+  error(ERR_ENDOFQUOTEEXPECTED, token->offset);
   return token; 
 }
 
@@ -211,13 +209,12 @@ Token* readStringConstant(void) {
 
 Token* getToken(void) {
   Token *token;
-  int ln, cn;
+  int off;
 
   if (currentChar == EOF)
-    return makeToken(TK_EOF, lineNo, colNo);
+    return makeToken(TK_EOF, charNo);
 
-  ln = lineNo;
-  cn = colNo;
+  off = charNo;
 
   switch (charCodes[currentChar]) {
     case CHAR_SPACE: 
@@ -233,11 +230,11 @@ Token* getToken(void) {
       return readStringConstant();
 
     case CHAR_PLUS: 
-      token = makeToken(SB_PLUS, ln, cn);
+      token = makeToken(SB_PLUS, off);
       readChar(); 
       return token;
     case CHAR_MINUS: 
-      token = makeToken(SB_MINUS, ln, cn);
+      token = makeToken(SB_MINUS, off);
       readChar(); 
       return token;
 
@@ -245,12 +242,12 @@ Token* getToken(void) {
       readChar(); 
       if (charCodes[currentChar] == CHAR_TIMES) {
           // Gặp '**', toán tử lũy thừa
-          token = makeToken(SB_EXPONENT, ln, cn);
+          token = makeToken(SB_EXPONENT, off);
           readChar();
           return token;
       } else {
           // Chỉ là toán tử nhân đơn '*'
-          return makeToken(SB_TIMES, ln, cn);
+          return makeToken(SB_TIMES, off);
       }
 
     case CHAR_SLASH:
@@ -261,79 +258,79 @@ Token* getToken(void) {
           return getToken();
       } else {
           // Chỉ là toán tử chia đơn '/'
-          return makeToken(SB_SLASH, ln, cn);
+          return makeToken(SB_SLASH, off);
       }
       
     case CHAR_PERCENTAGE:
       // Gặp '%', toán tử chia lấy dư
-      token = makeToken(SB_MOD, ln, cn);
+      token = makeToken(SB_MOD, off);
       readChar();
       return token;
 
     case CHAR_LT:
       readChar();
       if (currentChar == '=') {
-        token = makeToken(SB_LE, ln, cn);
+        token = makeToken(SB_LE, off);
         readChar();
         return token;
       } else {
-        return makeToken(SB_LT, ln, cn);
+        return makeToken(SB_LT, off);
       }
 
     case CHAR_GT:
       readChar();
       if (currentChar == '=') {
-        token = makeToken(SB_GE, ln, cn);
+        token = makeToken(SB_GE, off);
         readChar();
         return token;
       } else {
-        return makeToken(SB_GT, ln, cn);
+        return makeToken(SB_GT, off);
       }
 
     case CHAR_EXCLAIMATION:
       readChar();
       if (currentChar == '=') {
-        token = makeToken(SB_NEQ, ln, cn);
+        token = makeToken(SB_NEQ, off);
         readChar();
         return token;
       } else {
-        token = makeToken(TK_NONE, ln, cn);
-        error(ERR_INVALIDSYMBOL, ln, cn);
+        token = makeToken(TK_NONE, off);
+        error(ERR_INVALIDSYMBOL, off);
         return token;
       }
 
     case CHAR_EQ:
-      token = makeToken(SB_EQ, ln, cn);
+      token = makeToken(SB_EQ, off);
       readChar();
       return token;
 
     case CHAR_COMMA:
-      token = makeToken(SB_COMMA, ln, cn);
+      token = makeToken(SB_COMMA, off);
       readChar();
       return token;
 
     case CHAR_PERIOD:
       readChar();
       if (charCodes[currentChar] == CHAR_RPAR) {
-        token = makeToken(SB_RSEL, ln, cn);
+        token = makeToken(SB_RSEL, off);
         readChar();
         return token;
       } else {
-        return makeToken(SB_PERIOD, ln, cn);
+        return makeToken(SB_PERIOD, off);
       }
 
     case CHAR_COLON:
       readChar();
       if (currentChar == '=') {
-        token = makeToken(SB_ASSIGN, ln, cn);
+        token = makeToken(SB_ASSIGN, off);
         readChar();
         return token;
       } else {
-        return makeToken(SB_COLON, ln, cn);
+        return makeToken(SB_COLON, off);
       }
 
     case CHAR_SEMICOLON:
-      token = makeToken(SB_SEMICOLON, ln, cn);
+      token = makeToken(SB_SEMICOLON, off);
       readChar();
       return token;
       
@@ -344,176 +341,127 @@ Token* getToken(void) {
       readChar();
       switch (charCodes[currentChar]) {
         case CHAR_PERIOD:
-          token = makeToken(SB_LSEL, ln, cn);
+          token = makeToken(SB_LSEL, off);
           readChar();
           return token;
         case CHAR_TIMES:
           skipComment(); // Chú thích đa dòng (*...*)
           return getToken();
         default:
-          return makeToken(SB_LPAR, ln, cn);
+          return makeToken(SB_LPAR, off);
       }
 
     case CHAR_RPAR:
-      token = makeToken(SB_RPAR, ln, cn);
+      token = makeToken(SB_RPAR, off);
       readChar();
       return token;
       
     default:
-      token = makeToken(TK_NONE, ln, cn);
-      error(ERR_INVALIDSYMBOL, ln, cn);
+      token = makeToken(TK_NONE, off);
+      error(ERR_INVALIDSYMBOL, off);
       readChar();
       return token;
   }
 }
 /******************************************************************/
 
+// Tên in ra của từng loại token, đánh chỉ số theo TokenType
+const char *tokenNames[] = {
+  [TK_NONE] = "TK_NONE", [TK_IDENT] = "TK_IDENT", [TK_NUMBER] = "TK_NUMBER",
+  [TK_CHAR] = "TK_CHAR", [TK_EOF] = "TK_EOF", [TK_STRING] = "TK_STRING",
+
+  [KW_PROGRAM] = "KW_PROGRAM", [KW_CONST] = "KW_CONST", [KW_TYPE] = "KW_TYPE",
+  [KW_VAR] = "KW_VAR", [KW_INTEGER] = "KW_INTEGER", [KW_CHAR] = "KW_CHAR",
+  [KW_ARRAY] = "KW_ARRAY", [KW_OF] = "KW_OF", [KW_FUNCTION] = "KW_FUNCTION",
+  [KW_PROCEDURE] = "KW_PROCEDURE", [KW_BEGIN] = "KW_BEGIN", [KW_END] = "KW_END",
+  [KW_CALL] = "KW_CALL", [KW_IF] = "KW_IF", [KW_THEN] = "KW_THEN",
+  [KW_ELSE] = "KW_ELSE", [KW_WHILE] = "KW_WHILE", [KW_DO] = "KW_DO",
+  [KW_FOR] = "KW_FOR", [KW_TO] = "KW_TO", [KW_REPEAT] = "KW_REPEAT",
+  [KW_UNTIL] = "KW_UNTIL", [KW_BYTE] = "KW_BYTE", [KW_STRING] = "KW_STRING",
+
+  [SB_SEMICOLON] = "SB_SEMICOLON", [SB_COLON] = "SB_COLON", [SB_PERIOD] = "SB_PERIOD",
+  [SB_COMMA] = "SB_COMMA", [SB_ASSIGN] = "SB_ASSIGN", [SB_EQ] = "SB_EQ",
+  [SB_NEQ] = "SB_NEQ", [SB_LT] = "SB_LT", [SB_LE] = "SB_LE", [SB_GT] = "SB_GT",
+  [SB_GE] = "SB_GE", [SB_PLUS] = "SB_PLUS", [SB_MINUS] = "SB_MINUS",
+  [SB_TIMES] = "SB_TIMES", [SB_SLASH] = "SB_SLASH", [SB_LPAR] = "SB_LPAR",
+  [SB_RPAR] = "SB_RPAR", [SB_LSEL] = "SB_LSEL", [SB_RSEL] = "SB_RSEL",
+  [SB_MOD] = "SB_MOD", [SB_EXPONENT] = "SB_EXPONENT"
+};
+
+// Ghi số nguyên n dạng thập phân vào p, trả về vị trí ngay sau nó
+char *formatInt(char *p, int n)
+{
+  char digits[12];
+  unsigned int u = (n < 0) ? -(unsigned int) n : (unsigned int) n;
+  int i = 0;
+
+  if (n < 0)
+    *p++ = '-';
+  do
+  {
+    digits[i++] = '0' + u % 10;
+    u /= 10;
+  } while (u > 0);
+  while (i > 0)
+    *p++ = digits[--i];
+  return p;
+}
+
+char *appendText(char *p, const char *text, int length)
+{
+  memcpy(p, text, length);
+  return p + length;
+}
+
+// Mỗi token được dựng thành một dòng rồi ghi bằng một lần fwrite vào bộ
+// đệm của stdout, không qua printf
 void printToken(Token *token)
 {
+  char line[MAX_STRING_LENGTH + 64];
+  char *p = line;
+  const char *name;
+  int lineNo, colNo;
 
-  // KhÃ´ng in token lá»—i (TK_NONE)
+  // Không in token lỗi (TK_NONE)
   if (token->tokenType == TK_NONE)
     return;
 
-  printf("%d-%d:", token->lineNo, token->colNo);
+  getPosition(token->offset, &lineNo, &colNo);
+  p = formatInt(p, lineNo);
+  *p++ = '-';
+  p = formatInt(p, colNo);
+  *p++ = ':';
+
+  name = tokenNames[token->tokenType];
+  p = appendText(p, name, strlen(name));
 
   switch (token->tokenType)
   {
-  case TK_NONE:
-    printf("TK_NONE\n");
-    break;
   case TK_IDENT:
-    printf("TK_IDENT(%s)\n", token->string);
+    *p++ = '(';
+    p = appendText(p, tokenText(token), token->length);
+    *p++ = ')';
     break;
   case TK_NUMBER:
-    printf("TK_NUMBER(%d)\n", token->value);
+    *p++ = '(';
+    p = formatInt(p, token->value);
+    *p++ = ')';
     break;
   case TK_CHAR:
-    printf("TK_CHAR('%s')\n", token->string);
-    break;
-  case TK_EOF:
-    printf("TK_EOF\n");
-    break;
-
-  case KW_PROGRAM:
-    printf("KW_PROGRAM\n");
-    break;
-  case KW_CONST:
-    printf("KW_CONST\n");
-    break;
-  case KW_TYPE:
-    printf("KW_TYPE\n");
-    break;
-  case KW_VAR:
-    printf("KW_VAR\n");
-    break;
-  case KW_INTEGER:
-    printf("KW_INTEGER\n");
-    break;
-  case KW_CHAR:
-    printf("KW_CHAR\n");
-    break;
-  case KW_ARRAY:
-    printf("KW_ARRAY\n");
-    break;
-  case KW_OF:
-    printf("KW_OF\n");
-    break;
-  case KW_FUNCTION:
-    printf("KW_FUNCTION\n");
-    break;
-  case KW_PROCEDURE:
-    printf("KW_PROCEDURE\n");
-    break;
-  case KW_BEGIN:
-    printf("KW_BEGIN\n");
-    break;
-  case KW_END:
-    printf("KW_END\n");
-    break;
-  case KW_CALL:
-    printf("KW_CALL\n");
-    break;
-  case KW_IF:
-    printf("KW_IF\n");
-    break;
-  case KW_THEN:
-    printf("KW_THEN\n");
-    break;
-  case KW_ELSE:
-    printf("KW_ELSE\n");
-    break;
-  case KW_WHILE:
-    printf("KW_WHILE\n");
-    break;
-  case KW_DO:
-    printf("KW_DO\n");
-    break;
-  case KW_FOR:
-    printf("KW_FOR\n");
-    break;
-  case KW_TO:
-    printf("KW_TO\n");
-    break;
-
-  case SB_SEMICOLON:
-    printf("SB_SEMICOLON\n");
-    break;
-  case SB_COLON:
-    printf("SB_COLON\n");
-    break;
-  case SB_PERIOD:
-    printf("SB_PERIOD\n");
-    break;
-  case SB_COMMA:
-    printf("SB_COMMA\n");
-    break;
-  case SB_ASSIGN:
-    printf("SB_ASSIGN\n");
-    break;
-  case SB_EQ:
-    printf("SB_EQ\n");
-    break;
-  case SB_NEQ:
-    printf("SB_NEQ\n");
-    break;
-  case SB_LT:
-    printf("SB_LT\n");
-    break;
-  case SB_LE:
-    printf("SB_LE\n");
-    break;
-  case SB_GT:
-    printf("SB_GT\n");
-    break;
-  case SB_GE:
-    printf("SB_GE\n");
-    break;
-  case SB_PLUS:
-    printf("SB_PLUS\n");
-    break;
-  case SB_MINUS:
-    printf("SB_MINUS\n");
-    break;
-  case SB_TIMES:
-    printf("SB_TIMES\n");
-    break;
-  case SB_SLASH:
-    printf("SB_SLASH\n");
-    break;
-  case SB_LPAR:
-    printf("SB_LPAR\n");
-    break;
-  case SB_RPAR:
-    printf("SB_RPAR\n");
+    p = appendText(p, "('", 2);
+    *p++ = (char) token->value;
+    p = appendText(p, "')", 2);
     break;
-  case SB_LSEL:
-    printf("SB_LSEL\n");
+  case TK_STRING:
+    p = appendText(p, "(\"", 2);
+    p += decodeString(token, p);
+    p = appendText(p, "\")", 2);
     break;
-  case SB_RSEL:
-    printf("SB_RSEL\n");
+  default:
     break;
   }
+  *p++ = '\n';
+  fwrite(line, 1, p - line, stdout);
 }
 
 int scan(char *fileName)
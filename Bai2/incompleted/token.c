@@ -41,88 +41,57 @@ struct {
   {"STRING", KW_STRING}
 };
 
-int keywordEq(char *kw, char *string) {
-  while ((*kw != '\0') && (*string != '\0')) {
+extern char *source;
+
+int keywordEq(char *kw, char *string, int length) {
+  while ((*kw != '\0') && (length > 0)) {
     if (*kw != *string) break; 
-    kw ++; string ++;
+    kw ++; string ++; length --;
   }
-  return ((*kw == '\0') && (*string == '\0'));
+  return ((*kw == '\0') && (length == 0));
 }
 
-TokenType checkKeyword(char *string) {
+TokenType checkKeyword(char *string, int length) {
   int i;
   for (i = 0; i < KEYWORDS_COUNT; i++)
-    if (keywordEq(keywords[i].string, string)) 
+    if (keywordEq(keywords[i].string, string, length)) 
       return keywords[i].tokenType;
   return TK_IDENT;
 }
 
-Token* makeToken(TokenType tokenType, int lineNo, int colNo) {
+Token* makeToken(TokenType tokenType, int offset) {
   Token *token = (Token*)malloc(sizeof(Token));
   token->tokenType = tokenType;
-  token->lineNo = lineNo;
-  token->colNo = colNo;
-  // Khởi tạo string để tránh lỗi
-  memset(token->string, 0, MAX_STRING_LENGTH + 1); 
+  token->offset = offset;
+  token->length = 0;
+  token->value = 0;
   return token;
 }
 
-void printToken(Token *token) {
+// Văn bản của token trong nguồn, không kết thúc bằng '\0'
+char *tokenText(Token *token) {
+  return source + token->offset;
+}
 
-  switch (token->tokenType) {
-  case TK_NONE: printf("TK_NONE\n"); break;
-  case TK_IDENT: printf("TK_IDENT(%s)\n", token->string); break;
-  case TK_NUMBER: printf("TK_NUMBER(%d)\n", token->value); break;
-  case TK_CHAR: printf("TK_CHAR(\'%s\')\n", token->string); break;
-  case TK_STRING: printf("TK_STRING(\"%s\")\n", token->string); break; // In hằng xâu
-  case TK_EOF: printf("TK_EOF\n"); break;
+// Giải mã hằng xâu vào buffer (MAX_STRING_LENGTH + 1 byte): bỏ hai dấu
+// nháy kép, "" thành ", bỏ xuống dòng cùng các ký tự trắng đầu dòng sau.
+// Trả về độ dài xâu.
+int decodeString(Token *token, char *buffer) {
+  char *p = tokenText(token) + 1;
+  char *end = tokenText(token) + token->length;
+  int len = 0;
 
-  case KW_PROGRAM: printf("KW_PROGRAM\n"); break;
-  case KW_CONST: printf("KW_CONST\n"); break;
-  case KW_TYPE: printf("KW_TYPE\n"); break;
-  case KW_VAR: printf("KW_VAR\n"); break;
-  case KW_INTEGER: printf("KW_INTEGER\n"); break;
-  case KW_CHAR: printf("KW_CHAR\n"); break;
-  case KW_ARRAY: printf("KW_ARRAY\n"); break;
-  case KW_OF: printf("KW_OF\n"); break;
-  case KW_FUNCTION: printf("KW_FUNCTION\n"); break;
-  case KW_PROCEDURE: printf("KW_PROCEDURE\n"); break;
-  case KW_BEGIN: printf("KW_BEGIN\n"); break;
-  case KW_END: printf("KW_END\n"); break;
-  case KW_CALL: printf("KW_CALL\n"); break;
-  case KW_IF: printf("KW_IF\n"); break;
-  case KW_THEN: printf("KW_THEN\n"); break;
-  case KW_ELSE: printf("KW_ELSE\n"); break;
-  case KW_WHILE: printf("KW_WHILE\n"); break;
-  case KW_DO: printf("KW_DO\n"); break;
-  case KW_FOR: printf("KW_FOR\n"); break;
-  case KW_TO: printf("KW_TO\n"); break;
-  case KW_REPEAT: printf("KW_REPEAT\n"); break;
-  case KW_UNTIL: printf("KW_UNTIL\n"); break;
-  case KW_BYTE: printf("KW_BYTE\n"); break; // In keyword BYTE
-  case KW_STRING: printf("KW_STRING\n"); break; // In keyword STRING
+  if (end > p && *(end - 1) == '"') end --;
 
-  case SB_SEMICOLON: printf("SB_SEMICOLON\n"); break;
-  case SB_COLON: printf("SB_COLON\n"); break;
-  case SB_PERIOD: printf("SB_PERIOD\n"); break;
-  case SB_COMMA: printf("SB_COMMA\n"); break;
-  case SB_ASSIGN: printf("SB_ASSIGN\n"); break;
-  case SB_EQ: printf("SB_EQ\n"); break;
-  case SB_NEQ: printf("SB_NEQ\n"); break;
-  case SB_LT: printf("SB_LT\n"); break;
-  case SB_LE: printf("SB_LE\n"); break;
-  case SB_GT: printf("SB_GT\n"); break;
-  case SB_GE: printf("SB_GE\n"); break;
-  case SB_PLUS: printf("SB_PLUS\n"); break;
-  case SB_MINUS: printf("SB_MINUS\n"); break;
-  case SB_TIMES: printf("SB_TIMES\n"); break;
-  case SB_SLASH: printf("SB_SLASH\n"); break;
-  case SB_LPAR: printf("SB_LPAR\n"); break;
-  case SB_RPAR: printf("SB_RPAR\n"); break;
-  case SB_LSEL: printf("SB_LSEL\n"); break;
-  case SB_RSEL: printf("SB_RSEL\n"); break;
-  
-  case SB_MOD: printf("SB_MOD\n"); break;
-  case SB_EXPONENT: printf("SB_EXPONENT\n"); break;
+  while (p < end && len < MAX_STRING_LENGTH) {
+    if (*p == '\n') {
+      p ++;
+      while (p < end && (*p == ' ' || *p == '\t')) p ++;
+      continue;
+    }
+    if (*p == '"') p ++;
+    buffer[len++] = *p++;
   }
+  buffer[len] = '\0';
+  return len;
 }
@@ -12,8 +12,10 @@ typedef enum {
   TK_STRING 
 } TokenType;
 
+// Từ khóa và dấu được đánh số tiếp sau TokenType để không trùng giá trị,
+// vì chúng cùng được lưu trong tokenType
 typedef enum {
-  KW_PROGRAM, KW_CONST, KW_TYPE, KW_VAR, KW_INTEGER, KW_CHAR, KW_ARRAY,
+  KW_PROGRAM = TK_STRING + 1, KW_CONST, KW_TYPE, KW_VAR, KW_INTEGER, KW_CHAR, KW_ARRAY,
   KW_OF, KW_FUNCTION, KW_PROCEDURE, KW_BEGIN, KW_END, KW_CALL,
   KW_IF, KW_THEN, KW_ELSE, KW_WHILE, KW_DO, KW_FOR, KW_TO,
   KW_REPEAT, KW_UNTIL,
@@ -22,25 +24,27 @@ typedef enum {
 } KeywordType;
 
 typedef enum {
-  SB_SEMICOLON, SB_COLON, SB_PERIOD, SB_COMMA, SB_ASSIGN, SB_EQ, SB_NEQ,
+  SB_SEMICOLON = KW_STRING + 1, SB_COLON, SB_PERIOD, SB_COMMA, SB_ASSIGN, SB_EQ, SB_NEQ,
   SB_LT, SB_LE, SB_GT, SB_GE, SB_PLUS, SB_MINUS, SB_TIMES, SB_SLASH,
   SB_LPAR, SB_RPAR, SB_LSEL, SB_RSEL, 
   // Thêm Separator mới
   SB_MOD, SB_EXPONENT 
 } SeparatorType;
 
+// Token không chứa xâu: tên và hằng xâu là một đoạn (offset, length) của
+// văn bản nguồn. Dòng và cột được tính từ offset bằng getPosition().
 typedef struct {
-  // Cập nhật kích thước tối đa cho string (MAX_STRING_LENGTH + 1 cho ký tự NULL)
-  char string[MAX_STRING_LENGTH + 1]; 
-  int value;
-  int lineNo;
-  int colNo;
   TokenType tokenType;
+  int offset;
+  int length;
+  int value;
 } Token;
 
-Token* makeToken(TokenType tokenType, int lineNo, int colNo);
+Token* makeToken(TokenType tokenType, int offset);
 char *tokenToString(TokenType tokenType);
-TokenType checkKeyword(char *string);
+TokenType checkKeyword(char *string, int length);
+char *tokenText(Token *token);
+int decodeString(Token *token, char *buffer);
 void printToken(Token *token);
 
 #endif
@@ -0,0 +1,85 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "arena.h"
+
+#define ALIGN(n) (((n) + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1))
+
+/* The bytes of a block follow its header */
+#define BLOCK_BYTES(block) ((char*) (block) + ALIGN(sizeof(ArenaBlock)))
+
+void* arenaAlloc(Arena *arena, size_t size) {
+  ArenaBlock *block = arena->blocks;
+  void *p;
+
+  size = ALIGN(size);
+  if (block == NULL || block->used + size > block->size) {
+    size_t blockSize = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+
+    block = (ArenaBlock*) malloc(ALIGN(sizeof(ArenaBlock)) + blockSize);
+    block->next = arena->blocks;
+    block->size = blockSize;
+    block->used = 0;
+    arena->blocks = block;
+  }
+
+  p = BLOCK_BYTES(block) + block->used;
+  block->used += size;
+  return p;
+}
+
+ArenaMark markArena(Arena *arena) {
+  ArenaMark mark;
+
+  mark.block = arena->blocks;
+  mark.used = (mark.block == NULL) ? 0 : mark.block->used;
+  return mark;
+}
+
+/* Gives back what was allocated since mark and returns its size. The
+   mark is invalid once the arena has been reset. */
+size_t releaseArena(Arena *arena, ArenaMark mark) {
+  ArenaBlock *block;
+  size_t released = 0;
+
+  while (arena->blocks != mark.block) {
+    block = arena->blocks;
+    arena->blocks = block->next;
+    released += block->used;
+    free(block);
+  }
+  if (mark.block != NULL) {
+    released += mark.block->used - mark.used;
+    mark.block->used = mark.used;
+  }
+  return released;
+}
+
+/* Keeps the newest block for the next use of the arena */
+void resetArena(Arena *arena) {
+  ArenaBlock *block;
+
+  if (arena->blocks == NULL)
+    return;
+
+  while (arena->blocks->next != NULL) {
+    block = arena->blocks->next;
+    arena->blocks->next = block->next;
+    free(block);
+  }
+  arena->blocks->used = 0;
+}
+
+void freeArena(Arena *arena) {
+  ArenaBlock *block;
+
+  while (arena->blocks != NULL) {
+    block = arena->blocks;
+    arena->blocks = block->next;
+    free(block);
+  }
+}
@@ -0,0 +1,46 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_ALIGNMENT 8
+
+struct ArenaBlock_ {
+  struct ArenaBlock_ *next;
+  size_t size;
+  size_t used;
+};
+
+typedef struct ArenaBlock_ ArenaBlock;
+
+/* Memory of an arena is taken in order from its blocks and only given
+   back all at once */
+struct Arena_ {
+  ArenaBlock *blocks;
+};
+
+typedef struct Arena_ Arena;
+
+/* The top of an arena at some point; what was allocated after it can
+   be given back while older memory is kept */
+struct ArenaMark_ {
+  ArenaBlock *block;
+  size_t used;
+};
+
+typedef struct ArenaMark_ ArenaMark;
+
+void* arenaAlloc(Arena *arena, size_t size);
+ArenaMark markArena(Arena *arena);
+size_t releaseArena(Arena *arena, ArenaMark mark);
+void resetArena(Arena *arena);
+void freeArena(Arena *arena);
+
+#endif
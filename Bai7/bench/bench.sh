@@ -0,0 +1,17 @@
+#! /bin/bash
+# Generates KPL programs of several shapes, runs kplc on them and stores
+# the results in results/<commit>.json. Options after -- go to kplc.
+cd "$(dirname "$0")"
+make -s || exit 1
+(cd .. && make -s kplc) || exit 1
+mkdir -p programs results
+
+./kplgen -d 2 -w 3 -s 200 > programs/mixed.kpl
+./kplgen -d 14 -w 1 -s 20 > programs/nested.kpl
+./kplgen -d 0 -c 5000 -t 1000 -v 5000 -s 20 > programs/wide.kpl
+./kplgen -d 0 -s 4000 -e 40 > programs/expressions.kpl
+./kplgen -d 2 -w 3 -s 100 -m 90 -l 60 > programs/comments.kpl
+
+label=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+./kplbench -k ../kplc -n 5 -l $label -o results/$label.json programs/*.kpl "$@"
+cat results/$label.json
@@ -0,0 +1,204 @@
+/* Front end benchmark harness
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "reader.h"
+#include "tokenstream.h"
+
+/* Runs kplc on each program several times and writes one JSON object:
+   the best wall time of each program, the throughput it gives in tokens
+   and lines per second, and the largest peak RSS of the runs. Token and
+   line counts come from the scanner linked in here, outside the timed
+   runs. */
+
+#define MAX_KPLC_ARGS 32
+
+typedef struct {
+  char *fileName;
+  int bytes;
+  int lines;
+  int tokens;
+  double seconds;
+  long peakRss;
+  int exitStatus;
+} BenchResult;
+
+char *kplc = "../kplc";
+char *kplcArgs[MAX_KPLC_ARGS];
+int kplcArgCount = 0;
+int runCount = 3;
+
+int countProgram(BenchResult *result) {
+  Reader reader;
+  TokenStream *stream;
+  int i;
+
+  if (openReader(&reader, result->fileName) == IO_ERROR)
+    return IO_ERROR;
+
+  result->bytes = reader.sourceLength;
+  result->lines = 0;
+  for (i = 0; i < reader.sourceLength; i++)
+    if (reader.source[i] == '\n')
+      result->lines ++;
+  if (reader.sourceLength > 0 && reader.source[reader.sourceLength - 1] != '\n')
+    result->lines ++;
+
+  stream = tokenizeFrom(&reader);
+  result->tokens = stream->count - 1;  // not TK_EOF
+  freeTokenStream(stream);
+  closeReader(&reader);
+  return IO_SUCCESS;
+}
+
+double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* One run of kplc with its output discarded */
+void runOnce(BenchResult *result) {
+  char *argv[MAX_KPLC_ARGS + 3];
+  struct rusage usage;
+  double start, seconds;
+  int status, i, null;
+  pid_t pid;
+
+  argv[0] = kplc;
+  for (i = 0; i < kplcArgCount; i++)
+    argv[i + 1] = kplcArgs[i];
+  argv[kplcArgCount + 1] = result->fileName;
+  argv[kplcArgCount + 2] = NULL;
+
+  start = now();
+  pid = fork();
+  if (pid == 0) {
+    null = open("/dev/null", O_WRONLY);
+    dup2(null, 1);
+    dup2(null, 2);
+    execv(kplc, argv);
+    _exit(127);
+  }
+  if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) {
+    result->exitStatus = -1;
+    return;
+  }
+  seconds = now() - start;
+
+  if (result->seconds < 0 || seconds < result->seconds)
+    result->seconds = seconds;
+  // kilobytes on Linux
+  if (usage.ru_maxrss > result->peakRss)
+    result->peakRss = usage.ru_maxrss;
+  result->exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+void printString(FILE *f, char *s) {
+  fputc('"', f);
+  for (; *s != '\0'; s++) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', f);
+    fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+void printResults(FILE *f, char *label, BenchResult *results, int count) {
+  int i;
+
+  fprintf(f, "{\n  \"label\": ");
+  printString(f, label);
+  fprintf(f, ",\n  \"kplc\": ");
+  printString(f, kplc);
+  fprintf(f, ",\n  \"arguments\": [");
+  for (i = 0; i < kplcArgCount; i++) {
+    if (i > 0) fprintf(f, ", ");
+    printString(f, kplcArgs[i]);
+  }
+  fprintf(f, "],\n  \"runs\": %d,\n  \"results\": [", runCount);
+
+  for (i = 0; i < count; i++) {
+    BenchResult *r = &results[i];
+    double seconds = (r->seconds > 0) ? r->seconds : 1e-9;
+
+    fprintf(f, "%s\n    {\"file\": ", (i > 0) ? "," : "");
+    printString(f, r->fileName);
+    fprintf(f, ", \"bytes\": %d, \"lines\": %d, \"tokens\": %d, ", r->bytes, r->lines, r->tokens);
+    fprintf(f, "\"seconds\": %.6f, \"tokensPerSecond\": %.0f, \"linesPerSecond\": %.0f, ", 
+	    r->seconds, r->tokens / seconds, r->lines / seconds);
+    fprintf(f, "\"peakRssKb\": %ld, \"exitStatus\": %d}", r->peakRss, r->exitStatus);
+  }
+  fprintf(f, "\n  ]\n}\n");
+}
+
+void usage(void) {
+  printf("kplbench: [-k kplc] [-n runs] [-l label] [-o output.json] file... [-- kplc options]\n");
+}
+
+int main(int argc, char *argv[]) {
+  BenchResult *results = (BenchResult*) calloc(argc, sizeof(BenchResult));
+  char *label = "unknown";
+  char *output = NULL;
+  FILE *f = stdout;
+  int count = 0;
+  int i, run;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--") == 0) {
+      for (i++; i < argc && kplcArgCount < MAX_KPLC_ARGS; i++)
+	kplcArgs[kplcArgCount++] = argv[i];
+      break;
+    }
+    if (argv[i][0] == '-' && i + 1 < argc) {
+      switch (argv[i][1]) {
+      case 'k': kplc = argv[++i]; continue;
+      case 'n': runCount = atoi(argv[++i]); continue;
+      case 'l': label = argv[++i]; continue;
+      case 'o': output = argv[++i]; continue;
+      }
+    }
+    if (argv[i][0] == '-') {
+      usage();
+      return -1;
+    }
+    results[count++].fileName = argv[i];
+  }
+
+  if (count == 0 || runCount < 1) {
+    usage();
+    return -1;
+  }
+
+  for (i = 0; i < count; i++) {
+    if (countProgram(&results[i]) == IO_ERROR) {
+      printf("Can\'t read input file %s!\n", results[i].fileName);
+      return -1;
+    }
+    results[i].seconds = -1;
+    for (run = 0; run < runCount; run++)
+      runOnce(&results[i]);
+  }
+
+  if (output != NULL && (f = fopen(output, "w")) == NULL) {
+    printf("Can\'t write %s!\n", output);
+    return -1;
+  }
+  printResults(f, label, results, count);
+  if (f != stdout)
+    fclose(f);
+  free(results);
+  return 0;
+}
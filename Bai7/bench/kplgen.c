@@ -0,0 +1,425 @@
+/* KPL program generator for benchmarks
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Writes a syntactically and semantically valid KPL program to stdout.
+   Every name is declared once in the whole program, before it is used,
+   and only integers are mixed in expressions. The program is meant to
+   be compiled, not run: loops need not terminate. */
+
+#define MAX_LEVELS 64
+
+/* Shape of the program */
+int depth = 2;              // nesting of subroutines
+int width = 2;              // functions and procedures per block
+int constCount = 4;         // per CONST section
+int typeCount = 2;          // per TYPE section
+int varCount = 4;           // per VAR section
+int statementCount = 8;     // per block body
+int expressionLength = 3;   // terms per expression
+int commentPercent = 10;    // chance of a comment before a line
+int commentLength = 8;      // words per comment
+
+/* Kinds of names a block can use */
+typedef enum {
+  NAME_INT,          // integer variables and parameters
+  NAME_VARIABLE,     // integer variables only, for FOR loops
+  NAME_CONST,
+  NAME_ARRAY,
+  NAME_CHAR,
+  NAME_FUNCTION,
+  NAME_PROCEDURE,
+  NAME_KINDS
+} NameKind;
+
+typedef struct {
+  char **names[NAME_KINDS];
+  int counts[NAME_KINDS];
+  int capacities[NAME_KINDS];
+  char *owner;                    // function whose body this is
+} Scope;
+
+Scope *scopes[MAX_LEVELS];
+int level = -1;
+int nameCount = 0;
+
+char *words[] = {"the", "table", "holds", "values", "for", "each", "index", "loop", "sum", "of", "all", "items"};
+
+char* newName(char prefix) {
+  char *name = (char*) malloc(16);
+  sprintf(name, "%c%d", prefix, ++nameCount);
+  return name;
+}
+
+void addName(Scope *scope, NameKind kind, char *name) {
+  if (scope->counts[kind] == scope->capacities[kind]) {
+    scope->capacities[kind] = (scope->capacities[kind] == 0) ? 16 : scope->capacities[kind] * 2;
+    scope->names[kind] = (char**) realloc(scope->names[kind], scope->capacities[kind] * sizeof(char*));
+  }
+  scope->names[kind][scope->counts[kind]++] = name;
+}
+
+int chance(int percent) {
+  return rand() % 100 < percent;
+}
+
+/* A name of one kind visible from the current block, or NULL */
+char* pick(NameKind kind) {
+  int total = 0, k, l;
+
+  for (l = 0; l <= level; l++)
+    total += scopes[l]->counts[kind];
+  if (total == 0)
+    return NULL;
+  k = rand() % total;
+  for (l = 0; l <= level; l++) {
+    if (k < scopes[l]->counts[kind])
+      return scopes[l]->names[kind][k];
+    k -= scopes[l]->counts[kind];
+  }
+  return NULL;
+}
+
+void indent(int n) {
+  while (n-- > 0)
+    printf("  ");
+}
+
+void genComment(int margin) {
+  int i;
+
+  if (!chance(commentPercent))
+    return;
+  indent(margin);
+  printf("(*");
+  for (i = 0; i < commentLength; i++) {
+    printf(" %s", words[rand() % (sizeof(words) / sizeof(words[0]))]);
+    if (i % 12 == 11) {
+      printf("\n");
+      indent(margin + 1);
+    }
+  }
+  printf(" *)\n");
+}
+
+void genExpression(int nesting);
+
+void genFactor(int nesting) {
+  char *name;
+
+  switch (rand() % 6) {
+  case 0:
+    if ((name = pick(NAME_CONST)) != NULL) {
+      printf("%s", name);
+      return;
+    }
+    break;
+  case 1:
+  case 2:
+    if ((name = pick(NAME_INT)) != NULL) {
+      printf("%s", name);
+      return;
+    }
+    break;
+  case 3:
+    if (nesting > 0 && (name = pick(NAME_ARRAY)) != NULL) {
+      printf("%s(.", name);
+      genExpression(nesting - 1);
+      printf(".)");
+      return;
+    }
+    break;
+  case 4:
+    if (nesting > 0 && (name = pick(NAME_FUNCTION)) != NULL) {
+      printf("%s(", name);
+      genExpression(nesting - 1);
+      printf(")");
+      return;
+    }
+    break;
+  }
+  // the parser has no parenthesized factors
+  printf("%d", rand() % 1000);
+}
+
+void genTerm(int nesting) {
+  genFactor(nesting);
+  while (chance(30)) {
+    printf(rand() % 2 ? " * " : " / ");
+    genFactor(nesting);
+  }
+}
+
+/* Expressions nested in indexes and arguments are kept short, or the
+   size would grow with a power of expressionLength */
+void genExpression(int nesting) {
+  int terms = (nesting >= 2) ? expressionLength : 2;
+  int i;
+
+  if (chance(10))
+    printf("- ");
+  genTerm(nesting);
+  for (i = 1; i < terms; i++) {
+    printf(rand() % 2 ? " + " : " - ");
+    genTerm(nesting);
+  }
+}
+
+void genCondition(void) {
+  char *comparators[] = {" = ", " != ", " < ", " <= ", " > ", " >= "};
+  char *name;
+
+  if (chance(20) && (name = pick(NAME_CHAR)) != NULL) {
+    printf("%s%s'%c'", name, comparators[rand() % 2], 'a' + rand() % 26);
+    return;
+  }
+  genExpression(2);
+  printf("%s", comparators[rand() % 6]);
+  genExpression(2);
+}
+
+void genStatement(int margin, int nesting);
+
+void genStatements(int margin, int count, int nesting) {
+  int i;
+
+  for (i = 0; i < count; i++) {
+    genComment(margin);
+    genStatement(margin, nesting);
+    printf(i < count - 1 ? ";\n" : "\n");
+  }
+}
+
+void genStatement(int margin, int nesting) {
+  Scope *scope = scopes[level];
+  char *name, *target;
+
+  indent(margin);
+  switch (nesting > 0 ? rand() % 10 : rand() % 5) {
+  case 0:
+    if ((name = pick(NAME_ARRAY)) != NULL) {
+      printf("%s(.", name);
+      genExpression(1);
+      printf(".) := ");
+      genExpression(2);
+      return;
+    }
+    break;
+  case 1:
+    if ((name = pick(NAME_PROCEDURE)) != NULL && (target = pick(NAME_INT)) != NULL) {
+      printf("CALL %s(%s, ", name, target);
+      genExpression(2);
+      printf(")");
+      return;
+    }
+    break;
+  case 2:
+    if (scope->owner != NULL) {
+      printf("%s := ", scope->owner);
+      genExpression(2);
+      return;
+    }
+    if ((name = pick(NAME_CHAR)) != NULL) {
+      printf("%s := '%c'", name, 'a' + rand() % 26);
+      return;
+    }
+    break;
+  case 3:
+    printf("CALL WRITEI(");
+    genExpression(2);
+    printf(")");
+    return;
+  case 5:
+    printf("IF ");
+    genCondition();
+    printf(" THEN\n");
+    genStatement(margin + 1, nesting - 1);
+    if (chance(50)) {
+      printf("\n");
+      indent(margin);
+      printf("ELSE\n");
+      genStatement(margin + 1, nesting - 1);
+    }
+    return;
+  case 6:
+    printf("WHILE ");
+    genCondition();
+    printf(" DO\n");
+    genStatement(margin + 1, nesting - 1);
+    return;
+  case 7:
+    if ((name = pick(NAME_VARIABLE)) != NULL) {
+      printf("FOR %s := ", name);
+      genExpression(1);
+      printf(" TO ");
+      genExpression(1);
+      printf(" DO\n");
+      genStatement(margin + 1, nesting - 1);
+      return;
+    }
+    break;
+  case 8:
+  case 9:
+    printf("BEGIN\n");
+    genStatements(margin + 1, 1 + rand() % 3, nesting - 1);
+    indent(margin);
+    printf("END");
+    return;
+  }
+
+  if ((name = pick(NAME_INT)) != NULL) {
+    printf("%s := ", name);
+    genExpression(2);
+  }
+  else printf("CALL WRITELN");
+}
+
+void genBlock(int margin);
+
+void genSubroutine(int margin, int isFunction) {
+  Scope *outer = scopes[level];
+  Scope *scope = (Scope*) calloc(1, sizeof(Scope));
+  char *name = newName(isFunction ? 'F' : 'P');
+  char *first = newName('X');
+  char *second = newName('Y');
+  int i;
+
+  genComment(margin);
+  indent(margin);
+  if (isFunction) {
+    printf("FUNCTION %s(%s : INTEGER) : INTEGER;\n", name, first);
+    scope->owner = name;
+  }
+  else printf("PROCEDURE %s(VAR %s : INTEGER; %s : INTEGER);\n", name, first, second);
+
+  addName(scope, NAME_INT, first);
+  if (!isFunction)
+    addName(scope, NAME_INT, second);
+  scopes[++level] = scope;
+  genBlock(margin);
+  level --;
+  printf(";\n\n");
+  for (i = 0; i < NAME_KINDS; i++)
+    free(scope->names[i]);
+  free(scope);
+
+  // declared after its body, so it is only called from later code
+  addName(outer, isFunction ? NAME_FUNCTION : NAME_PROCEDURE, name);
+}
+
+void genBlock(int margin) {
+  Scope *scope = scopes[level];
+  char **types = (char**) malloc((typeCount + 1) * sizeof(char*));
+  char *name;
+  int i;
+
+  if (constCount > 0) {
+    indent(margin);
+    printf("CONST\n");
+    for (i = 0; i < constCount; i++) {
+      char *name = newName('K');
+      char *other = pick(NAME_CONST);
+
+      genComment(margin + 1);
+      indent(margin + 1);
+      if (other != NULL && chance(25))
+	printf("%s = %s%s;\n", name, chance(50) ? "-" : "", other);
+      else printf("%s = %d;\n", name, rand() % 10000);
+      addName(scope, NAME_CONST, name);
+    }
+  }
+
+  if (typeCount > 0) {
+    indent(margin);
+    printf("TYPE\n");
+    for (i = 0; i < typeCount; i++) {
+      types[i] = newName('T');
+      genComment(margin + 1);
+      indent(margin + 1);
+      printf("%s = ARRAY(. %d .) OF INTEGER;\n", types[i], 1 + rand() % 100);
+    }
+  }
+
+  indent(margin);
+  printf("VAR\n");
+  // an array variable of each type
+  for (i = 0; i < typeCount; i++) {
+    name = newName('A');
+    indent(margin + 1);
+    printf("%s : %s;\n", name, types[i]);
+    addName(scope, NAME_ARRAY, name);
+  }
+  for (i = 0; i < varCount; i++) {
+    name = newName('V');
+    genComment(margin + 1);
+    indent(margin + 1);
+    printf("%s : INTEGER;\n", name);
+    addName(scope, NAME_INT, name);
+    addName(scope, NAME_VARIABLE, name);
+  }
+  name = newName('C');
+  indent(margin + 1);
+  printf("%s : CHAR;\n", name);
+  addName(scope, NAME_CHAR, name);
+  free(types);
+  printf("\n");
+
+  if (level < depth)
+    for (i = 0; i < width; i++) {
+      genSubroutine(margin + 1, 1);
+      genSubroutine(margin + 1, 0);
+    }
+
+  indent(margin);
+  printf("BEGIN\n");
+  genStatements(margin + 1, statementCount, 3);
+  indent(margin);
+  printf("END");
+}
+
+void usage(void) {
+  printf("kplgen: [-d depth] [-w width] [-c consts] [-t types] [-v vars]\n"
+	 "        [-s statements] [-e expression terms] [-m comment percent]\n"
+	 "        [-l comment words] [-r seed]\n");
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int seed = 1;
+  int i;
+
+  for (i = 1; i + 1 < argc; i += 2) {
+    int value = atoi(argv[i + 1]);
+
+    if (strcmp(argv[i], "-d") == 0) depth = value;
+    else if (strcmp(argv[i], "-w") == 0) width = value;
+    else if (strcmp(argv[i], "-c") == 0) constCount = value;
+    else if (strcmp(argv[i], "-t") == 0) typeCount = value;
+    else if (strcmp(argv[i], "-v") == 0) varCount = value;
+    else if (strcmp(argv[i], "-s") == 0) statementCount = value;
+    else if (strcmp(argv[i], "-e") == 0) expressionLength = value;
+    else if (strcmp(argv[i], "-m") == 0) commentPercent = value;
+    else if (strcmp(argv[i], "-l") == 0) commentLength = value;
+    else if (strcmp(argv[i], "-r") == 0) seed = value;
+    else {
+      usage();
+      return -1;
+    }
+  }
+  if (i < argc || depth >= MAX_LEVELS - 1) {
+    usage();
+    return -1;
+  }
+
+  srand(seed);
+  scopes[++level] = (Scope*) calloc(1, sizeof(Scope));
+  printf("PROGRAM BENCH;\n");
+  genBlock(0);
+  printf(".\n");
+  return 0;
+}
@@ -45,43 +45,43 @@ void printObject(Object* obj, int indent) {
   switch (obj->kind) {
   case OBJ_CONSTANT:
     pad(indent);
-    printf("Const %s = ", obj->name);
-    printConstantValue(obj->constAttrs->value);
+    printf("Const %s = ", symbolName(obj->symbol));
+    printConstantValue(&(obj->constAttrs.value));
     break;
   case OBJ_TYPE:
     pad(indent);
-    printf("Type %s = ", obj->name);
-    printType(obj->typeAttrs->actualType);
+    printf("Type %s = ", symbolName(obj->symbol));
+    printType(obj->typeAttrs.actualType);
     break;
   case OBJ_VARIABLE:
     pad(indent);
-    printf("Var %s : ", obj->name);
-    printType(obj->varAttrs->type);
+    printf("Var %s : ", symbolName(obj->symbol));
+    printType(obj->varAttrs.type);
     break;
   case OBJ_PARAMETER:
     pad(indent);
-    if (obj->paramAttrs->kind == PARAM_VALUE) 
-      printf("Param %s : ", obj->name);
+    if (obj->paramAttrs.kind == PARAM_VALUE) 
+      printf("Param %s : ", symbolName(obj->symbol));
     else
-      printf("Param VAR %s : ", obj->name);
-    printType(obj->paramAttrs->type);
+      printf("Param VAR %s : ", symbolName(obj->symbol));
+    printType(obj->paramAttrs.type);
     break;
   case OBJ_FUNCTION:
     pad(indent);
-    printf("Function %s : ",obj->name);
-    printType(obj->funcAttrs->returnType);
+    printf("Function %s : ",symbolName(obj->symbol));
+    printType(obj->funcAttrs.returnType);
     printf("\n");
-    printScope(obj->funcAttrs->scope, indent + 4);
+    printSubprogramScope(obj->funcAttrs.scope, obj->funcAttrs.paramList, indent + 4);
     break;
   case OBJ_PROCEDURE:
     pad(indent);
-    printf("Procedure %s\n",obj->name);
-    printScope(obj->procAttrs->scope, indent + 4);
+    printf("Procedure %s\n",symbolName(obj->symbol));
+    printSubprogramScope(obj->procAttrs.scope, obj->procAttrs.paramList, indent + 4);
     break;
   case OBJ_PROGRAM:
     pad(indent);
-    printf("Program %s\n",obj->name);
-    printScope(obj->progAttrs->scope, indent + 4);
+    printf("%s %s\n", obj->progAttrs.isUnit ? "Unit" : "Program", symbolName(obj->symbol));
+    printScope(obj->progAttrs.scope, indent + 4);
     break;
   }
 }
@@ -99,3 +99,49 @@ void printScope(Scope* scope, int indent) {
   printObjectList(scope->objList, indent);
 }
 
+/* A subprogram whose scope was released has only its parameters */
+void printSubprogramScope(Scope* scope, ObjectNode* paramList, int indent) {
+  if (scope != NULL)
+    printScope(scope, indent);
+  else printObjectList(paramList, indent);
+}
+
+
+/* The last entry counts everything from its index on */
+void printLevelCounts(char *title, int *counts, int size) {
+  int i;
+
+  printf("%s:", title);
+  for (i = 0; i < size; i++)
+    if (counts[i] > 0)
+      printf(" %d%s:%d", i, (i == size - 1) ? "+" : "", counts[i]);
+  printf("\n");
+}
+
+void printSymTabStats(void) {
+  char *objectNames[] = {"constant", "variable", "type", "function", "procedure", "parameter", "program"};
+  char *allocNames[] = {"type", "constant", "object", "node", "scope", "table", "symtab"};
+  long total = 0;
+  int i;
+
+  printf("Symbol table statistics\n");
+
+  printf("Objects:");
+  for (i = 0; i <= OBJ_PROGRAM; i++)
+    printf(" %s %d%s", objectNames[i], symtabStats.objects[i], (i < OBJ_PROGRAM) ? "," : "\n");
+  printf("Array types: %d\n", symtabStats.arrayTypes);
+
+  printLevelCounts("Scopes by level", symtabStats.scopes, STATS_MAX_LEVEL + 1);
+  printLevelCounts("Lookups by level", symtabStats.lookups, STATS_MAX_LEVEL + 1);
+  printf("Failed lookups: %d\n", symtabStats.failedLookups);
+  printLevelCounts("Lookup chain lengths", symtabStats.chainLengths, STATS_MAX_LEVEL + 1);
+  printf("Hash probes: %ld, collisions: %ld\n", symtabStats.probes, symtabStats.collisions);
+  printf("Released scopes: %d, bytes: %ld\n", symtabStats.releasedScopes, symtabStats.releasedBytes);
+
+  printf("Bytes:");
+  for (i = 0; i < NUM_OF_ALLOC_KINDS; i++) {
+    printf(" %s %ld,", allocNames[i], symtabStats.bytes[i]);
+    total += symtabStats.bytes[i];
+  }
+  printf(" total %ld\n", total);
+}
@@ -14,5 +14,7 @@ void printConstantValue(ConstantValue* value);
 void printObject(Object* obj, int indent);
 void printObjectList(ObjectNode* objList, int indent);
 void printScope(Scope* scope, int indent);
+void printSubprogramScope(Scope* scope, ObjectNode* paramList, int indent);
+void printSymTabStats(void);
 
 #endif
@@ -6,59 +6,233 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "reader.h"
 #include "error.h"
 
-#define NUM_OF_ERRORS 29
+#define NUM_OF_ERRORS 34
 
-struct ErrorMessage {
-  ErrorCode errorCode;
-  char *message;
+/* Messages indexed by ErrorCode */
+char *errorMessages[NUM_OF_ERRORS] = {
+  [ERR_END_OF_COMMENT] = "End of comment expected.",
+  [ERR_IDENT_TOO_LONG] = "Identifier too long.",
+  [ERR_INVALID_CONSTANT_CHAR] = "Invalid char constant.",
+  [ERR_INVALID_SYMBOL] = "Invalid symbol.",
+  [ERR_NUMBER_TOO_LARGE] = "Number too large.",
+  [ERR_INVALID_IDENT] = "An identifier expected.",
+  [ERR_INVALID_CONSTANT] = "A constant expected.",
+  [ERR_INVALID_TYPE] = "A type expected.",
+  [ERR_INVALID_BASICTYPE] = "A basic type expected.",
+  [ERR_INVALID_VARIABLE] = "A variable expected.",
+  [ERR_INVALID_FUNCTION] = "A function identifier expected.",
+  [ERR_INVALID_PROCEDURE] = "A procedure identifier expected.",
+  [ERR_INVALID_PARAMETER] = "A parameter expected.",
+  [ERR_INVALID_STATEMENT] = "Invalid statement.",
+  [ERR_INVALID_COMPARATOR] = "A comparator expected.",
+  [ERR_INVALID_EXPRESSION] = "Invalid expression.",
+  [ERR_INVALID_TERM] = "Invalid term.",
+  [ERR_INVALID_FACTOR] = "Invalid factor.",
+  [ERR_INVALID_LVALUE] = "Invalid lvalue in assignment.",
+  [ERR_INVALID_ARGUMENTS] = "Wrong arguments.",
+  [ERR_UNDECLARED_IDENT] = "Undeclared identifier.",
+  [ERR_UNDECLARED_CONSTANT] = "Undeclared constant.",
+  [ERR_UNDECLARED_INT_CONSTANT] = "Undeclared integer constant.",
+  [ERR_UNDECLARED_TYPE] = "Undeclared type.",
+  [ERR_UNDECLARED_VARIABLE] = "Undeclared variable.",
+  [ERR_UNDECLARED_FUNCTION] = "Undeclared function.",
+  [ERR_UNDECLARED_PROCEDURE] = "Undeclared procedure.",
+  [ERR_DUPLICATE_IDENT] = "Duplicate identifier.",
+  [ERR_TYPE_INCONSISTENCY] = "Type inconsistency",
+  [ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY] = "The number of arguments and the number of parameters are inconsistent.",
+  [ERR_UNDECLARED_UNIT] = "Undeclared unit.",
+  [ERR_INVALID_UNIT] = "The unit can't be compiled.",
+  [ERR_MISSING_TOKEN] = "Missing",
+  [ERR_TOO_MANY_IDENTIFIERS] = "Too many identifiers."
 };
 
-struct ErrorMessage errors[29] = {
-  {ERR_END_OF_COMMENT, "End of comment expected."},
-  {ERR_IDENT_TOO_LONG, "Identifier too long."},
-  {ERR_INVALID_CONSTANT_CHAR, "Invalid char constant."},
-  {ERR_INVALID_SYMBOL, "Invalid symbol."},
-  {ERR_INVALID_IDENT, "An identifier expected."},
-  {ERR_INVALID_CONSTANT, "A constant expected."},
-  {ERR_INVALID_TYPE, "A type expected."},
-  {ERR_INVALID_BASICTYPE, "A basic type expected."},
-  {ERR_INVALID_VARIABLE, "A variable expected."},
-  {ERR_INVALID_FUNCTION, "A function identifier expected."},
-  {ERR_INVALID_PROCEDURE, "A procedure identifier expected."},
-  {ERR_INVALID_PARAMETER, "A parameter expected."},
-  {ERR_INVALID_STATEMENT, "Invalid statement."},
-  {ERR_INVALID_COMPARATOR, "A comparator expected."},
-  {ERR_INVALID_EXPRESSION, "Invalid expression."},
-  {ERR_INVALID_TERM, "Invalid term."},
-  {ERR_INVALID_FACTOR, "Invalid factor."},
-  {ERR_INVALID_LVALUE, "Invalid lvalue in assignment."},
-  {ERR_INVALID_ARGUMENTS, "Wrong arguments."},
-  {ERR_UNDECLARED_IDENT, "Undeclared identifier."},
-  {ERR_UNDECLARED_CONSTANT, "Undeclared constant."},
-  {ERR_UNDECLARED_INT_CONSTANT, "Undeclared integer constant."},
-  {ERR_UNDECLARED_TYPE, "Undeclared type."},
-  {ERR_UNDECLARED_VARIABLE, "Undeclared variable."},
-  {ERR_UNDECLARED_FUNCTION, "Undeclared function."},
-  {ERR_UNDECLARED_PROCEDURE, "Undeclared procedure."},
-  {ERR_DUPLICATE_IDENT, "Duplicate identifier."},
-  {ERR_TYPE_INCONSISTENCY, "Type inconsistency"},
-  {ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, "The number of arguments and the number of parameters are inconsistent."}
-};
+/* Diagnostics of batch mode; without it, the first error ends the
+   compilation. The limit holds for every compilation after
+   beginDiagnostics. */
+Diagnostic *diagnostics = NULL;
+int diagnosticCount = 0;
+int diagnosticLimit = 0;
+int tooManyErrors = 0;
 
-void error(ErrorCode err, int lineNo, int colNo) {
-  int i;
-  for (i = 0 ; i < NUM_OF_ERRORS; i ++) 
-    if (errors[i].errorCode == err) {
-      printf("%d-%d:%s\n", lineNo, colNo, errors[i].message);
-      exit(0);
+/* Set by the parser around the part it can resume after */
+jmp_buf *recoveryPoint = NULL;
+/* Set by the parser around a whole compilation, which stops there
+   after too many errors */
+jmp_buf *abortPoint = NULL;
+
+/* Also receives every diagnostic as a line of JSON when set */
+FILE *diagnosticSink = NULL;
+/* The source the diagnostics are about, NULL for a buffer */
+char *diagnosticFile = NULL;
+
+void setDiagnosticSink(FILE *sink) {
+  diagnosticSink = sink;
+}
+
+void setDiagnosticFile(char *fileName) {
+  diagnosticFile = fileName;
+}
+
+/* Writes the characters of s as they go in a JSON string */
+void writeJsonChars(FILE *f, const char *s) {
+  for (; *s != '\0'; s++) {
+    switch (*s) {
+    case '"': fputs("\\\"", f); break;
+    case '\\': fputs("\\\\", f); break;
+    case '\n': fputs("\\n", f); break;
+    case '\t': fputs("\\t", f); break;
+    default:
+      if ((unsigned char) *s < 0x20)
+	fprintf(f, "\\u%04x", (unsigned char) *s);
+      else fputc(*s, f);
     }
+  }
+}
+
+void writeDiagnostic(FILE *f, Diagnostic *diagnostic) {
+  fputs("{\"file\":", f);
+  if (diagnosticFile != NULL) {
+    fputc('"', f);
+    writeJsonChars(f, diagnosticFile);
+    fputc('"', f);
+  }
+  else fputs("null", f);
+
+  fprintf(f, ",\"line\":%d,\"column\":%d,\"offset\":%d,\"code\":%d,\"message\":\"", 
+	  diagnostic->lineNo, diagnostic->colNo, diagnostic->offset, diagnostic->errorCode);
+  writeJsonChars(f, errorMessages[diagnostic->errorCode]);
+  if (diagnostic->errorCode == ERR_MISSING_TOKEN) {
+    fputc(' ', f);
+    writeJsonChars(f, tokenToString(diagnostic->missingToken));
+  }
+  fputs("\"}\n", f);
+}
+
+void printDiagnostic(Diagnostic *diagnostic) {
+  if (diagnosticSink != NULL)
+    writeDiagnostic(diagnosticSink, diagnostic);
+
+  if (diagnostic->errorCode == ERR_MISSING_TOKEN)
+    printf("%d-%d:%s %s\n", diagnostic->lineNo, diagnostic->colNo, 
+	   errorMessages[ERR_MISSING_TOKEN], tokenToString(diagnostic->missingToken));
+  else printf("%d-%d:%s\n", diagnostic->lineNo, diagnostic->colNo, errorMessages[diagnostic->errorCode]);
+}
+
+void beginDiagnostics(int limit) {
+  diagnostics = (Diagnostic*) realloc(diagnostics, limit * sizeof(Diagnostic));
+  diagnosticCount = 0;
+  diagnosticLimit = limit;
+}
+
+int inBatchMode(void) {
+  return diagnosticLimit > 0;
+}
+
+/* Back to ending a compilation at its first error */
+void endBatchMode(void) {
+  diagnosticCount = 0;
+  diagnosticLimit = 0;
+}
+
+/* The number of diagnostics of the current compilation so far */
+int diagnosticsCollected(void) {
+  return diagnosticCount;
+}
+
+/* Forgets the collected diagnostics and the recovery points, keeping
+   the mode, for a compilation started from within another one */
+void resetDiagnostics(void) {
+  diagnosticCount = 0;
+  tooManyErrors = 0;
+  recoveryPoint = NULL;
+  abortPoint = NULL;
+}
+
+/* Prints the diagnostics of a compilation and returns their number;
+   the list is emptied for the next one */
+int endDiagnostics(void) {
+  int count = diagnosticCount;
+  int i;
+
+  for (i = 0; i < diagnosticCount; i++)
+    printDiagnostic(&diagnostics[i]);
+  if (tooManyErrors)
+    printf("Too many errors.\n");
+
+  diagnosticCount = 0;
+  tooManyErrors = 0;
+  return count;
+}
+
+/* Stops the compilation at its outermost recovery point */
+void abortCompilation(void) {
+  recoveryPoint = NULL;
+  if (abortPoint == NULL) {
+    endDiagnostics();
+    exit(0);
+  }
+  longjmp(*abortPoint, 1);
+}
+
+void addDiagnostic(ErrorCode err, TokenType tokenType, Token *token) {
+  Diagnostic diagnostic;
+  int offset = token->offset;
+
+  diagnostic.offset = offset;
+  diagnostic.errorCode = err;
+  diagnostic.missingToken = tokenType;
+  if (token->lineNo > 0) {
+    diagnostic.lineNo = token->lineNo;
+    diagnostic.colNo = token->colNo;
+  }
+  else getPosition(offset, &diagnostic.lineNo, &diagnostic.colNo);
+
+  if (diagnosticLimit == 0) {
+    printDiagnostic(&diagnostic);
+    exit(0);
+  }
+
+  // an error at the same place is a consequence of the previous one
+  if (diagnosticCount > 0 && diagnostics[diagnosticCount - 1].offset == offset)
+    return;
+
+  diagnostics[diagnosticCount++] = diagnostic;
+  if (diagnosticCount == diagnosticLimit) {
+    tooManyErrors = 1;
+    abortCompilation();
+  }
+  // no identifier after this one could be told apart from another
+  if (err == ERR_TOO_MANY_IDENTIFIERS)
+    abortCompilation();
+}
+
+/* The parser goes on from the next token after these two */
+void reportError(ErrorCode err, Token *token) {
+  addDiagnostic(err, TK_NONE, token);
+}
+
+void reportMissingToken(TokenType tokenType, Token *token) {
+  addDiagnostic(ERR_MISSING_TOKEN, tokenType, token);
+}
+
+/* Resumes at the innermost recovery point */
+void recover(void) {
+  if (recoveryPoint == NULL)
+    abortCompilation();
+  longjmp(*recoveryPoint, 1);
+}
+
+void error(ErrorCode err, Token *token) {
+  reportError(err, token);
+  recover();
 }
 
-void missingToken(TokenType tokenType, int lineNo, int colNo) {
-  printf("%d-%d:Missing %s\n", lineNo, colNo, tokenToString(tokenType));
-  exit(0);
+void missingToken(TokenType tokenType, Token *token) {
+  reportMissingToken(tokenType, token);
+  recover();
 }
 
 void assert(char *msg) {
@@ -6,6 +6,8 @@
 
 #ifndef __ERROR_H__
 #define __ERROR_H__
+#include <stdio.h>
+#include <setjmp.h>
 #include "token.h"
 
 typedef enum {
@@ -13,6 +15,7 @@ typedef enum {
   ERR_IDENT_TOO_LONG,
   ERR_INVALID_CONSTANT_CHAR,
   ERR_INVALID_SYMBOL,
+  ERR_NUMBER_TOO_LARGE,
   ERR_INVALID_IDENT,
   ERR_INVALID_CONSTANT,
   ERR_INVALID_TYPE,
@@ -37,11 +40,41 @@ typedef enum {
   ERR_UNDECLARED_PROCEDURE,
   ERR_DUPLICATE_IDENT,
   ERR_TYPE_INCONSISTENCY,
-  ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY
+  ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY,
+  ERR_UNDECLARED_UNIT,
+  ERR_INVALID_UNIT,
+  ERR_MISSING_TOKEN,
+  ERR_TOO_MANY_IDENTIFIERS
 } ErrorCode;
 
-void error(ErrorCode err, int lineNo, int colNo);
-void missingToken(TokenType tokenType, int lineNo, int colNo);
+/* In batch mode, errors are collected instead of ending the compilation.
+   Errors are reported at a token, whose position is found from its
+   offset unless it carries it. An ERR_MISSING_TOKEN diagnostic has the type of the token in
+   missingToken, other errors have missingToken == TK_NONE */
+typedef struct {
+  int offset;
+  int lineNo;
+  int colNo;
+  ErrorCode errorCode;
+  TokenType missingToken;
+} Diagnostic;
+
+extern jmp_buf *recoveryPoint;
+extern jmp_buf *abortPoint;
+
+void setDiagnosticSink(FILE *sink);
+void setDiagnosticFile(char *fileName);
+void beginDiagnostics(int limit);
+int inBatchMode(void);
+void endBatchMode(void);
+int diagnosticsCollected(void);
+void resetDiagnostics(void);
+int endDiagnostics(void);
+
+void reportError(ErrorCode err, Token *token);
+void reportMissingToken(TokenType tokenType, Token *token);
+void error(ErrorCode err, Token *token);
+void missingToken(TokenType tokenType, Token *token);
 void assert(char *msg);
 
 #endif
@@ -0,0 +1,169 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "intern.h"
+
+#define INITIAL_BUCKETS 256
+#define NAME_BLOCK_SIZE 4096
+#define NAME_PAGE_BITS 12
+#define NAME_PAGE_SIZE (1 << NAME_PAGE_BITS)
+#define MAX_NAME_PAGES 4096
+
+struct NameBlock_ {
+  struct NameBlock_ *next;
+  int used;
+  char bytes[NAME_BLOCK_SIZE];
+};
+
+typedef struct NameBlock_ NameBlock;
+
+/* A table only grows. The spelling of symbol id is in a page of
+   NAME_PAGE_SIZE names that never moves, and a page is in namePages
+   before any ID in it is handed out, so the global table's names are
+   read without the lock. Entry 0 of page 0 is unused so that
+   SYMBOL_NONE never names an identifier. buckets is an open addressing
+   table of symbol IDs, 0 marks an empty bucket. */
+struct InternTable_ {
+  char **namePages[MAX_NAME_PAGES];
+  int symbolCount;
+  SymbolId *buckets;
+  int bucketCount;
+  NameBlock *nameBlocks;
+};
+
+InternTable globalSymbols;
+
+/* scanners on several threads intern into the global table */
+pthread_mutex_t internLock = PTHREAD_MUTEX_INITIALIZER;
+
+#define NAME_OF(table, id) ((table)->namePages[(id) >> NAME_PAGE_BITS][(id) & (NAME_PAGE_SIZE - 1)])
+
+unsigned int hashName(char *name) {
+  unsigned int h = 2166136261u;
+  while (*name != '\0') {
+    h ^= (unsigned char) *name++;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+char* storeName(InternTable *table, char *name) {
+  int len = strlen(name) + 1;
+  char *s;
+
+  if (table->nameBlocks == NULL || table->nameBlocks->used + len > NAME_BLOCK_SIZE) {
+    NameBlock *block = (NameBlock*) malloc(sizeof(NameBlock));
+    block->next = table->nameBlocks;
+    block->used = 0;
+    table->nameBlocks = block;
+  }
+  s = table->nameBlocks->bytes + table->nameBlocks->used;
+  memcpy(s, name, len);
+  table->nameBlocks->used += len;
+  return s;
+}
+
+void growBuckets(InternTable *table) {
+  int i;
+  int newCount = (table->bucketCount == 0) ? INITIAL_BUCKETS : table->bucketCount * 2;
+  SymbolId *newBuckets = (SymbolId*) calloc(newCount, sizeof(SymbolId));
+
+  for (i = 1; i <= table->symbolCount; i++) {
+    unsigned int b = hashName(NAME_OF(table, i)) & (newCount - 1);
+    while (newBuckets[b] != SYMBOL_NONE)
+      b = (b + 1) & (newCount - 1);
+    newBuckets[b] = i;
+  }
+  free(table->buckets);
+  table->buckets = newBuckets;
+  table->bucketCount = newCount;
+}
+
+InternTable* makeInternTable(void) {
+  return (InternTable*) calloc(1, sizeof(InternTable));
+}
+
+/* Returns SYMBOL_NONE once the table is full; the scanner reports it
+   as ERR_TOO_MANY_IDENTIFIERS */
+SymbolId internSymbolIn(InternTable *table, char *name) {
+  unsigned int b;
+  SymbolId symbol;
+
+  if ((table->symbolCount + 1) * 2 > table->bucketCount)
+    growBuckets(table);
+
+  b = hashName(name) & (table->bucketCount - 1);
+  while (table->buckets[b] != SYMBOL_NONE) {
+    if (strcmp(NAME_OF(table, table->buckets[b]), name) == 0)
+      return table->buckets[b];
+    b = (b + 1) & (table->bucketCount - 1);
+  }
+
+  symbol = table->symbolCount + 1;
+  if ((symbol >> NAME_PAGE_BITS) == MAX_NAME_PAGES)
+    return SYMBOL_NONE;
+  if (table->namePages[symbol >> NAME_PAGE_BITS] == NULL) {
+    table->namePages[symbol >> NAME_PAGE_BITS] = (char**) malloc(NAME_PAGE_SIZE * sizeof(char*));
+    table->namePages[symbol >> NAME_PAGE_BITS][0] = "";
+  }
+  NAME_OF(table, symbol) = storeName(table, name);
+  table->buckets[b] = symbol;
+  table->symbolCount = symbol;
+  return symbol;
+}
+
+char* symbolNameIn(InternTable *table, SymbolId symbol) {
+  return NAME_OF(table, symbol);
+}
+
+int symbolCountIn(InternTable *table) {
+  return table->symbolCount;
+}
+
+void clearInternTable(InternTable *table) {
+  int i;
+
+  while (table->nameBlocks != NULL) {
+    NameBlock *block = table->nameBlocks;
+    table->nameBlocks = block->next;
+    free(block);
+  }
+  for (i = 0; i < MAX_NAME_PAGES && table->namePages[i] != NULL; i++) {
+    free(table->namePages[i]);
+    table->namePages[i] = NULL;
+  }
+  free(table->buckets);
+  table->buckets = NULL;
+  table->symbolCount = 0;
+  table->bucketCount = 0;
+}
+
+void freeInternTable(InternTable *table) {
+  clearInternTable(table);
+  free(table);
+}
+
+SymbolId internSymbol(char *name) {
+  SymbolId symbol;
+
+  pthread_mutex_lock(&internLock);
+  symbol = internSymbolIn(&globalSymbols, name);
+  pthread_mutex_unlock(&internLock);
+  return symbol;
+}
+
+char* symbolName(SymbolId symbol) {
+  return NAME_OF(&globalSymbols, symbol);
+}
+
+/* Symbol IDs are kept by every compilation of the process, so the
+   global table is freed only once none runs */
+void cleanInternTable(void) {
+  clearInternTable(&globalSymbols);
+}
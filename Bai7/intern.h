@@ -0,0 +1,30 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+/* Every distinct identifier is stored once in a global table and
+   referred to by its symbol ID everywhere else */
+typedef unsigned int SymbolId;
+
+#define SYMBOL_NONE 0
+
+SymbolId internSymbol(char *name);
+char* symbolName(SymbolId symbol);
+void cleanInternTable(void);
+
+/* A table of one thread, with IDs of its own; the global table takes
+   its names when they are kept */
+typedef struct InternTable_ InternTable;
+
+InternTable* makeInternTable(void);
+SymbolId internSymbolIn(InternTable *table, char *name);
+char* symbolNameIn(InternTable *table, SymbolId symbol);
+int symbolCountIn(InternTable *table);
+void freeInternTable(InternTable *table);
+
+#endif
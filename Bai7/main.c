@@ -6,22 +6,89 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "reader.h"
 #include "parser.h"
+#include "symimage.h"
+#include "error.h"
+#include "debug.h"
 
 /******************************************************************/
 
 int main(int argc, char *argv[]) {
-  if (argc <= 1) {
+  char *fileName = NULL;
+  int pretokenize = 0;
+  int threadCount = 1;
+  int useCache = 0;
+  int maxErrors = 0;
+  int stats = 0;
+  FILE *sink = NULL;
+  int result;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--pretokenize") == 0)
+      pretokenize = 1;
+    else if (strcmp(argv[i], "--token-cache") == 0) {
+      pretokenize = 1;
+      useCache = 1;
+    }
+    else if (strcmp(argv[i], "--lex-threads") == 0 && i + 1 < argc) {
+      pretokenize = 1;
+      threadCount = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--stats") == 0)
+      stats = 1;
+    else if (strcmp(argv[i], "--stream") == 0)
+      setStreaming(1);
+    else if (strcmp(argv[i], "--symbol-image") == 0 && i + 1 < argc) {
+      // declarations compiled before, in place of the built-in ones
+      if (!loadSymbolImage(argv[++i])) {
+	printf("Can\'t load symbol image %s!\n", argv[i]);
+	return -1;
+      }
+    }
+    else if (strcmp(argv[i], "--save-symbol-image") == 0 && i + 1 < argc)
+      setSymbolImageOutput(argv[++i]);
+    else if (strcmp(argv[i], "--max-errors") == 0 && i + 1 < argc)
+      maxErrors = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--diagnostics-json") == 0 && i + 1 < argc) {
+      // one JSON object per line for each diagnostic
+      if ((sink = fopen(argv[++i], "w")) == NULL) {
+	printf("Can\'t write %s!\n", argv[i]);
+	return -1;
+      }
+      setDiagnosticSink(sink);
+    }
+    else fileName = argv[i];
+  }
+
+  if (fileName == NULL) {
     printf("parser: no input file.\n");
     return -1;
   }
 
-  if (compile(argv[1]) == IO_ERROR) {
+  // report up to maxErrors errors instead of stopping at the first one
+  if (maxErrors > 0)
+    beginDiagnostics(maxErrors);
+
+  if (pretokenize)
+    result = compileTokenized(fileName, threadCount, useCache);
+  else result = compile(fileName);
+
+  if (sink != NULL)
+    fclose(sink);
+
+  if (result == IO_ERROR) {
     printf("Can\'t read input file!\n");
     return -1;
   }
-    
+
+  // the counters outlive the symbol table
+  if (stats)
+    printSymTabStats();
+
+  cleanInternTable();
   return 0;
 }
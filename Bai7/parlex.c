@@ -0,0 +1,221 @@
+/* Parallel lexing
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "scanner.h"
+#include "error.h"
+#include "parlex.h"
+
+/* The source is cut into chunks that are lexed at the same time. A
+   chunk may begin inside a comment, so each one is lexed twice: once
+   from its start as plain code, once as if a comment were open there.
+   Tokens that straddle a chunk start (identifiers, numbers, char
+   constants, two-character symbols) need no third guess; they are
+   handled by resynchronization below.
+
+   Between two tokens the scanner has no state besides its offset. So
+   if the sequential scanner and a speculative run ever stand at the
+   same offset between tokens, they produce the same tokens from there
+   on. Stitching walks the chunks in order, finds in one of the two
+   runs the offset where the previous chunk stopped, and copies the
+   run's tokens from there. If neither run passes through that offset
+   the chunk is lexed again sequentially.
+
+   Each run interns its identifiers in a table of its own, so the
+   threads never wait on the global one and a run that is thrown away
+   leaves nothing in it. The tokens taken from a run get their global
+   IDs while stitching, in source order, which numbers them as a
+   sequential scan would. */
+
+#define START_IN_CODE 0
+#define START_IN_COMMENT 1
+
+#define MIN_CHUNK_SIZE 65536
+
+/* The start of a token read while still inside the assumed comment is
+   -1. exit is the first start at or after the chunk end, -1 once EOF
+   was read. */
+typedef struct {
+  TokenStream *stream;
+  InternTable *symbols;
+  int exit;
+} ChunkRun;
+
+typedef struct {
+  char *source;
+  int sourceLength;
+  int start;
+  int end;
+  ChunkRun runs[2];
+} Chunk;
+
+void lexRun(ChunkRun *run, char *source, int sourceLength, int start, int end, int startState) {
+  Reader reader;
+  Token *token;
+  int resume;
+
+  run->stream = (TokenStream*) calloc(1, sizeof(TokenStream));
+  run->symbols = makeInternTable();
+  run->exit = -1;
+
+  attachReader(&reader, source, sourceLength);
+  reader.symbols = run->symbols;
+  reader.charNo = start - 1;
+  readCharFrom(&reader);
+
+  if (startState == START_IN_COMMENT && !skipComment(&reader)) {
+    token = makeToken(TK_NONE, reader.charNo);
+    token->value = ERR_END_OF_COMMENT;
+    appendToken(run->stream, token, -1, reader.charNo);
+    free(token);
+  }
+
+  while (1) {
+    resume = reader.charNo;
+    if (resume >= end && end < sourceLength) {
+      run->exit = resume;
+      break;
+    }
+    token = getTokenFrom(&reader);
+    appendToken(run->stream, token, resume, reader.charNo);
+    free(token);
+    if (run->stream->tokenTypes[run->stream->count - 1] == TK_EOF)
+      break;
+  }
+  closeReader(&reader);
+}
+
+void freeRun(ChunkRun *run) {
+  if (run->stream != NULL) {
+    freeTokenStream(run->stream);
+    freeInternTable(run->symbols);
+  }
+}
+
+void* lexChunk(void *arg) {
+  Chunk *chunk = (Chunk*) arg;
+
+  lexRun(&chunk->runs[START_IN_CODE], chunk->source, chunk->sourceLength, 
+	 chunk->start, chunk->end, START_IN_CODE);
+  if (chunk->start > 0)
+    lexRun(&chunk->runs[START_IN_COMMENT], chunk->source, chunk->sourceLength, 
+	   chunk->start, chunk->end, START_IN_COMMENT);
+  return NULL;
+}
+
+/* Index of the token read from offset resume, or -1 */
+int findResume(ChunkRun *run, int resume) {
+  int lo = 0, hi = run->stream->count;
+
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (run->stream->starts[mid] < resume) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo < run->stream->count && run->stream->starts[lo] == resume)
+    return lo;
+  return -1;
+}
+
+/* Appends the tokens of run from first on, with global symbol IDs */
+void appendRange(TokenStream *stream, ChunkRun *run, int first) {
+  TokenStream *from = run->stream;
+  int n = from->count - first;
+  SymbolId *globalIds;
+  int i;
+
+  if (n == 0)
+    return;
+  while (stream->count + n > stream->capacity)
+    growTokenStream(stream);
+  memcpy(stream->tokenTypes + stream->count, from->tokenTypes + first, n * sizeof(unsigned char));
+  memcpy(stream->starts + stream->count, from->starts + first, n * sizeof(int));
+  memcpy(stream->offsets + stream->count, from->offsets + first, n * sizeof(int));
+  memcpy(stream->lengths + stream->count, from->lengths + first, n * sizeof(int));
+  memcpy(stream->values + stream->count, from->values + first, n * sizeof(int));
+
+  globalIds = (SymbolId*) calloc(symbolCountIn(run->symbols) + 1, sizeof(SymbolId));
+  for (i = stream->count; i < stream->count + n; i++)
+    if (stream->tokenTypes[i] == TK_IDENT) {
+      if (globalIds[stream->values[i]] == SYMBOL_NONE)
+	globalIds[stream->values[i]] = internSymbol(symbolNameIn(run->symbols, stream->values[i]));
+      if (globalIds[stream->values[i]] == SYMBOL_NONE) {
+	// reported like the scanner reports it
+	stream->tokenTypes[i] = TK_NONE;
+	stream->values[i] = ERR_TOO_MANY_IDENTIFIERS;
+      }
+      else stream->values[i] = globalIds[stream->values[i]];
+    }
+  free(globalIds);
+  stream->count += n;
+}
+
+/* Produces the same tokens as tokenizeFrom(reader), lexing the reader's
+   buffer on up to threadCount threads; the reader itself is not moved.
+   A streamed input, or one too short to be cut, is lexed by
+   tokenizeFrom(reader) instead, which reads the reader to its end. */
+TokenStream* tokenizeParallel(Reader *reader, int threadCount) {
+  TokenStream *stream;
+  Chunk *chunks;
+  pthread_t *threads;
+  int chunkCount = threadCount;
+  int resume = reader->charNo;
+  int c;
+
+  if (chunkCount > reader->sourceLength / MIN_CHUNK_SIZE)
+    chunkCount = reader->sourceLength / MIN_CHUNK_SIZE;
+  if (chunkCount <= 1 || resume != 0 || reader->input != NULL)
+    return tokenizeFrom(reader);
+
+  chunks = (Chunk*) calloc(chunkCount, sizeof(Chunk));
+  threads = (pthread_t*) malloc(chunkCount * sizeof(pthread_t));
+  for (c = 0; c < chunkCount; c++) {
+    chunks[c].source = reader->source;
+    chunks[c].sourceLength = reader->sourceLength;
+    chunks[c].start = (int) ((long long) reader->sourceLength * c / chunkCount);
+    chunks[c].end = (int) ((long long) reader->sourceLength * (c + 1) / chunkCount);
+  }
+
+  for (c = 1; c < chunkCount; c++)
+    pthread_create(&threads[c], NULL, lexChunk, &chunks[c]);
+  lexChunk(&chunks[0]);
+  for (c = 1; c < chunkCount; c++)
+    pthread_join(threads[c], NULL);
+
+  stream = (TokenStream*) calloc(1, sizeof(TokenStream));
+  for (c = 0; c < chunkCount && resume >= 0; c++) {
+    ChunkRun *run = NULL;
+    ChunkRun retry;
+    int first = findResume(&chunks[c].runs[START_IN_CODE], resume);
+
+    if (first >= 0)
+      run = &chunks[c].runs[START_IN_CODE];
+    else if (c > 0 && (first = findResume(&chunks[c].runs[START_IN_COMMENT], resume)) >= 0)
+      run = &chunks[c].runs[START_IN_COMMENT];
+
+    if (run == NULL) {
+      // neither guess lines up with the real scanner, lex this chunk again
+      lexRun(&retry, reader->source, reader->sourceLength, resume, chunks[c].end, START_IN_CODE);
+      appendRange(stream, &retry, 0);
+      resume = retry.exit;
+      freeRun(&retry);
+    } else {
+      appendRange(stream, run, first);
+      resume = run->exit;
+    }
+  }
+
+  for (c = 0; c < chunkCount; c++) {
+    freeRun(&chunks[c].runs[START_IN_CODE]);
+    freeRun(&chunks[c].runs[START_IN_COMMENT]);
+  }
+  free(chunks);
+  free(threads);
+  return stream;
+}
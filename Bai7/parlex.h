@@ -0,0 +1,15 @@
+/* Parallel lexing
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PARLEX_H__
+#define __PARLEX_H__
+
+#include "reader.h"
+#include "tokenstream.h"
+
+TokenStream* tokenizeParallel(Reader *reader, int threadCount);
+
+#endif
@@ -5,71 +5,196 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <setjmp.h>
 
 #include "reader.h"
 #include "scanner.h"
+#include "tokenstream.h"
+#include "parlex.h"
+#include "tokencache.h"
+#include "symimage.h"
+#include "unit.h"
 #include "parser.h"
 #include "semantics.h"
 #include "error.h"
 #include "debug.h"
 
+/* Errors collected by compileBuffer when no limit was set */
+#define BUFFER_MAX_ERRORS 100
+
 Token *currentToken;
 Token *lookAhead;
 
+TokenStream *tokenStream = NULL;
+int tokenCursor;
+/* Tokens of the stream are read into these two in turn, into the one
+   lookAhead does not hold; they are not freed */
+Token streamTokens[2];
+
+/* The file compiled, NULL for a buffer; units are imported from its
+   directory */
+char *sourceFileName = NULL;
+/* Set in the process compiling a unit for another compilation, which
+   only writes the unit's interface */
+int interfaceOnly = 0;
+/* In streaming mode, each subprogram is printed once compiled and its
+   scope released, so only the scopes still open take memory */
+int streaming = 0;
+
+void setStreaming(int on) {
+  streaming = on;
+}
+
+extern Reader inputReader;
 extern Type* intType;
 extern Type* charType;
 extern SymTab* symtab;
 
+Token* nextToken(void) {
+  Token* token;
+
+  if (tokenStream == NULL)
+    return getValidToken();
+
+  token = (lookAhead == &streamTokens[0]) ? &streamTokens[1] : &streamTokens[0];
+  do {
+    // the last entry is TK_EOF, the cursor never moves past it
+    readStreamToken(tokenStream, tokenCursor, token);
+    if (tokenCursor < tokenStream->count - 1)
+      tokenCursor ++;
+
+    // in batch mode, the invalid token is skipped after its report
+    if (token->tokenType == TK_NONE)
+      reportError((ErrorCode) token->value, token);
+  } while (token->tokenType == TK_NONE);
+  return token;
+}
+
+void freeToken(Token* token) {
+  if (tokenStream == NULL)
+    free(token);
+}
+
+/* The tokens are moved only once the next one is read, so that an
+   error ending the compilation inside nextToken leaves them as they are */
 void scan(void) {
-  Token* tmp = currentToken;
+  Token* next = nextToken();
+  freeToken(currentToken);
   currentToken = lookAhead;
-  lookAhead = getValidToken();
-  free(tmp);
+  lookAhead = next;
 }
 
 void eat(TokenType tokenType) {
   if (lookAhead->tokenType == tokenType) {
     scan();
-  } else missingToken(tokenType, lookAhead->lineNo, lookAhead->colNo);
+  } else missingToken(tokenType, lookAhead);
+}
+
+/* Synchronization sets for panic mode, ended by TK_NONE */
+TokenType programFollow[] = {TK_NONE};
+TokenType statementFollow[] = {SB_SEMICOLON, KW_END, KW_ELSE, TK_NONE};
+TokenType declarationFollow[] = {SB_SEMICOLON, KW_TYPE, KW_VAR, KW_FUNCTION, KW_PROCEDURE, KW_BEGIN, TK_NONE};
+TokenType paramFollow[] = {SB_SEMICOLON, SB_RPAR, KW_CONST, KW_TYPE, KW_BEGIN, TK_NONE};
+TokenType headerFollow[] = {SB_SEMICOLON, KW_CONST, KW_TYPE, KW_VAR, KW_FUNCTION, KW_PROCEDURE, KW_BEGIN, TK_NONE};
+TokenType subprogramFollow[] = {SB_SEMICOLON, KW_FUNCTION, KW_PROCEDURE, KW_BEGIN, TK_NONE};
+TokenType expressionFollow[] = {KW_TO, KW_DO, SB_RPAR, SB_COMMA, SB_EQ, SB_NEQ, SB_LE, SB_LT, SB_GE, SB_GT, 
+				SB_RSEL, SB_SEMICOLON, KW_END, KW_ELSE, KW_THEN, TK_NONE};
+TokenType termFollow[] = {SB_PLUS, SB_MINUS, KW_TO, KW_DO, SB_RPAR, SB_COMMA, SB_EQ, SB_NEQ, SB_LE, SB_LT, SB_GE, SB_GT, 
+			  SB_RSEL, SB_SEMICOLON, KW_END, KW_ELSE, KW_THEN, TK_NONE};
+
+int isFollow(TokenType *follow) {
+  for (; *follow != TK_NONE; follow++)
+    if (lookAhead->tokenType == *follow)
+      return 1;
+  return 0;
+}
+
+void skipTo(TokenType *follow) {
+  while (lookAhead->tokenType != TK_EOF && !isFollow(follow))
+    scan();
+}
+
+/* Runs compile under a recovery point: after an error inside it, the
+   tokens up to one of follow are skipped and 1 is returned */
+int compileRecovering(void (*compile)(void), TokenType *follow) {
+  jmp_buf recovery;
+  jmp_buf *outer = recoveryPoint;
+
+  if (setjmp(recovery) != 0) {
+    recoveryPoint = outer;
+    skipTo(follow);
+    return 1;
+  }
+
+  recoveryPoint = &recovery;
+  compile();
+  recoveryPoint = outer;
+  return 0;
 }
 
 void compileProgram(void) {
   Object* program;
+  int isUnit = (lookAhead->tokenType == KW_UNIT);
 
-  eat(KW_PROGRAM);
+  if (isUnit)
+    eat(KW_UNIT);
+  else eat(KW_PROGRAM);
   eat(TK_IDENT);
 
-  program = createProgramObject(currentToken->string);
-  enterBlock(program->progAttrs->scope);
+  program = createProgramObject(currentToken->symbol);
+  program->progAttrs.isUnit = isUnit;
+  enterBlock(program->progAttrs.scope);
 
   eat(SB_SEMICOLON);
 
+  compileImports();
   compileBlock();
   eat(SB_PERIOD);
 
   exitBlock();
 }
 
-void compileBlock(void) {
-  Object* constObj;
-  ConstantValue* constValue;
-
-  if (lookAhead->tokenType == KW_CONST) {
-    eat(KW_CONST);
+void compileImports(void) {
+  if (lookAhead->tokenType == KW_IMPORT) {
+    eat(KW_IMPORT);
+    compileImport();
 
-    do {
-      eat(TK_IDENT);
+    while (lookAhead->tokenType == SB_COMMA) {
+      eat(SB_COMMA);
+      compileImport();
+    }
+    eat(SB_SEMICOLON);
+  }
+}
 
-      checkFreshIdent(currentToken->string);
-      constObj = createConstantObject(currentToken->string);
+void compileImport(void) {
+  eat(TK_IDENT);
 
-      eat(SB_EQ);
-      constValue = compileConstant();
+  switch (importUnit(sourceFileName, symbolName(currentToken->symbol))) {
+  case IMPORT_NOT_FOUND:
+    error(ERR_UNDECLARED_UNIT, currentToken);
+    break;
+  case IMPORT_FAILED:
+    error(ERR_INVALID_UNIT, currentToken);
+    break;
+  case IMPORT_DUPLICATE:
+    error(ERR_DUPLICATE_IDENT, currentToken);
+    break;
+  default:
+    break;
+  }
+}
 
-      constObj->constAttrs->value = constValue;
-      declareObject(constObj);
+void compileBlock(void) {
+  if (lookAhead->tokenType == KW_CONST) {
+    eat(KW_CONST);
 
-      eat(SB_SEMICOLON);
+    do {
+      // after an error, go on with the next declaration
+      if (compileRecovering(compileConstDecl, declarationFollow) && lookAhead->tokenType == SB_SEMICOLON)
+	eat(SB_SEMICOLON);
     } while (lookAhead->tokenType == TK_IDENT);
 
     compileBlock2();
@@ -78,25 +203,12 @@ void compileBlock(void) {
 }
 
 void compileBlock2(void) {
-  Object* typeObj;
-  Type* actualType;
-
   if (lookAhead->tokenType == KW_TYPE) {
     eat(KW_TYPE);
 
     do {
-      eat(TK_IDENT);
-
-      checkFreshIdent(currentToken->string);
-      typeObj = createTypeObject(currentToken->string);
-
-      eat(SB_EQ);
-      actualType = compileType();
-
-      typeObj->typeAttrs->actualType = actualType;
-      declareObject(typeObj);
-
-      eat(SB_SEMICOLON);
+      if (compileRecovering(compileTypeDecl, declarationFollow) && lookAhead->tokenType == SB_SEMICOLON)
+	eat(SB_SEMICOLON);
     } while (lookAhead->tokenType == TK_IDENT);
 
     compileBlock3();
@@ -105,25 +217,12 @@ void compileBlock2(void) {
 }
 
 void compileBlock3(void) {
-  Object* varObj;
-  Type* varType;
-
   if (lookAhead->tokenType == KW_VAR) {
     eat(KW_VAR);
 
     do {
-      eat(TK_IDENT);
-
-      checkFreshIdent(currentToken->string);
-      varObj = createVariableObject(currentToken->string);
-
-      eat(SB_COLON);
-      varType = compileType();
-
-      varObj->varAttrs->type = varType;
-      declareObject(varObj);
-
-      eat(SB_SEMICOLON);
+      if (compileRecovering(compileVarDecl, declarationFollow) && lookAhead->tokenType == SB_SEMICOLON)
+	eat(SB_SEMICOLON);
     } while (lookAhead->tokenType == TK_IDENT);
 
     compileBlock4();
@@ -131,6 +230,60 @@ void compileBlock3(void) {
   else compileBlock4();
 }
 
+void compileConstDecl(void) {
+  Object* constObj;
+  ConstantValue* constValue;
+
+  eat(TK_IDENT);
+
+  checkFreshIdent(currentToken->symbol);
+  constObj = createConstantObject(currentToken->symbol);
+
+  eat(SB_EQ);
+  constValue = compileConstant();
+
+  constObj->constAttrs.value = *constValue;
+  declareObject(constObj);
+
+  eat(SB_SEMICOLON);
+}
+
+void compileTypeDecl(void) {
+  Object* typeObj;
+  Type* actualType;
+
+  eat(TK_IDENT);
+
+  checkFreshIdent(currentToken->symbol);
+  typeObj = createTypeObject(currentToken->symbol);
+
+  eat(SB_EQ);
+  actualType = compileType();
+
+  typeObj->typeAttrs.actualType = actualType;
+  declareObject(typeObj);
+
+  eat(SB_SEMICOLON);
+}
+
+void compileVarDecl(void) {
+  Object* varObj;
+  Type* varType;
+
+  eat(TK_IDENT);
+
+  checkFreshIdent(currentToken->symbol);
+  varObj = createVariableObject(currentToken->symbol);
+
+  eat(SB_COLON);
+  varType = compileType();
+
+  varObj->varAttrs.type = varType;
+  declareObject(varObj);
+
+  eat(SB_SEMICOLON);
+}
+
 void compileBlock4(void) {
   compileSubDecls();
   compileBlock5();
@@ -142,38 +295,85 @@ void compileBlock5(void) {
   eat(KW_END);
 }
 
+void compileSubDecl(void) {
+  if (lookAhead->tokenType == KW_FUNCTION)
+    compileFuncDecl();
+  else compileProcDecl();
+}
+
 void compileSubDecls(void) {
+  Scope* scope = symtab->currentScope;
+
   while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE)) {
-    if (lookAhead->tokenType == KW_FUNCTION)
-      compileFuncDecl();
-    else compileProcDecl();
+    // after an error the declaration could not go on from, leave the
+    // scopes it was in and go on with the next one
+    if (compileRecovering(compileSubDecl, subprogramFollow)) {
+      while (symtab->currentScope != scope)
+	exitBlock();
+      if (lookAhead->tokenType == SB_SEMICOLON)
+	eat(SB_SEMICOLON);
+    }
   }
 }
 
-void compileFuncDecl(void) {
-  Object* funcObj;
-  Type* returnType;
-
-  eat(KW_FUNCTION);
-  eat(TK_IDENT);
+void exitSubprogram(Object* obj) {
+  Scope* scope = symtab->currentScope;
 
-  checkFreshIdent(currentToken->string);
-  funcObj = createFunctionObject(currentToken->string);
-  declareObject(funcObj);
+  exitBlock();
+  if (streaming) {
+    // like the final dump, nothing is printed once there are errors
+    if (!interfaceOnly && diagnosticsCollected() == 0) {
+      printObject(obj, 4 * obj->level);
+      printf("\n");
+    }
+    releaseScope(scope);
+  }
+}
 
-  enterBlock(funcObj->funcAttrs->scope);
+/* The headers are compiled in the subprogram's scope, under a recovery
+   point of their own: after an error, the block is compiled still */
+void compileFuncHeader(void) {
+  Object* funcObj = symtab->currentScope->owner;
+  Type* returnType;
 
   compileParams();
 
   eat(SB_COLON);
   returnType = compileBasicType();
-  funcObj->funcAttrs->returnType = returnType;
+  funcObj->funcAttrs.returnType = returnType;
 
   eat(SB_SEMICOLON);
+}
+
+void compileProcHeader(void) {
+  compileParams();
+  eat(SB_SEMICOLON);
+}
+
+void compileFuncDecl(void) {
+  Object* funcObj;
+
+  eat(KW_FUNCTION);
+  eat(TK_IDENT);
+
+  funcObj = createFunctionObject(currentToken->symbol);
+  // a duplicate is compiled all the same, but not declared
+  if (checkFreshSubprogram(currentToken->symbol))
+    declareObject(funcObj);
+
+  enterBlock(funcObj->funcAttrs.scope);
+
+  if (compileRecovering(compileFuncHeader, headerFollow)) {
+    // so that the block can be checked
+    if (funcObj->funcAttrs.returnType == NULL)
+      funcObj->funcAttrs.returnType = makeIntType();
+    if (lookAhead->tokenType == SB_SEMICOLON)
+      eat(SB_SEMICOLON);
+  }
   compileBlock();
   eat(SB_SEMICOLON);
 
-  exitBlock();
+  exitSubprogram(funcObj);
 }
 
 void compileProcDecl(void) {
@@ -182,19 +382,18 @@ void compileProcDecl(void) {
   eat(KW_PROCEDURE);
   eat(TK_IDENT);
 
-  checkFreshIdent(currentToken->string);
-  procObj = createProcedureObject(currentToken->string);
-  declareObject(procObj);
+  procObj = createProcedureObject(currentToken->symbol);
+  if (checkFreshSubprogram(currentToken->symbol))
+    declareObject(procObj);
 
-  enterBlock(procObj->procAttrs->scope);
+  enterBlock(procObj->procAttrs.scope);
 
-  compileParams();
-
-  eat(SB_SEMICOLON);
+  if (compileRecovering(compileProcHeader, headerFollow) && lookAhead->tokenType == SB_SEMICOLON)
+    eat(SB_SEMICOLON);
   compileBlock();
   eat(SB_SEMICOLON);
 
-  exitBlock();
+  exitSubprogram(procObj);
 }
 
 ConstantValue* compileUnsignedConstant(void) {
@@ -209,8 +408,8 @@ ConstantValue* compileUnsignedConstant(void) {
   case TK_IDENT:
     eat(TK_IDENT);
 
-    obj = checkDeclaredConstant(currentToken->string);
-    constValue = duplicateConstantValue(obj->constAttrs->value);
+    obj = checkDeclaredConstant(currentToken->symbol);
+    constValue = duplicateConstantValue(&(obj->constAttrs.value));
 
     break;
   case TK_CHAR:
@@ -218,7 +417,7 @@ ConstantValue* compileUnsignedConstant(void) {
     constValue = makeCharConstant(currentToken->string[0]);
     break;
   default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_CONSTANT, lookAhead);
     break;
   }
   return constValue;
@@ -259,14 +458,14 @@ ConstantValue* compileConstant2(void) {
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredConstant(currentToken->string);
-    if (obj->constAttrs->value->type == TP_INT)
-      constValue = duplicateConstantValue(obj->constAttrs->value);
+    obj = checkDeclaredConstant(currentToken->symbol);
+    if (obj->constAttrs.value.type == TP_INT)
+      constValue = duplicateConstantValue(&(obj->constAttrs.value));
     else
-      error(ERR_UNDECLARED_INT_CONSTANT,currentToken->lineNo, currentToken->colNo);
+      error(ERR_UNDECLARED_INT_CONSTANT,currentToken);
     break;
   default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_CONSTANT, lookAhead);
     break;
   }
   return constValue;
@@ -301,11 +500,11 @@ Type* compileType(void) {
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredType(currentToken->string);
-    type = duplicateType(obj->typeAttrs->actualType);
+    obj = checkDeclaredType(currentToken->symbol);
+    type = obj->typeAttrs.actualType;
     break;
   default:
-    error(ERR_INVALID_TYPE, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_TYPE, lookAhead);
     break;
   }
   return type;
@@ -324,7 +523,7 @@ Type* compileBasicType(void) {
     type = makeCharType();
     break;
   default:
-    error(ERR_INVALID_BASICTYPE, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_BASICTYPE, lookAhead);
     break;
   }
   return type;
@@ -333,10 +532,10 @@ Type* compileBasicType(void) {
 void compileParams(void) {
   if (lookAhead->tokenType == SB_LPAR) {
     eat(SB_LPAR);
-    compileParam();
+    compileRecovering(compileParam, paramFollow);
     while (lookAhead->tokenType == SB_SEMICOLON) {
       eat(SB_SEMICOLON);
-      compileParam();
+      compileRecovering(compileParam, paramFollow);
     }
     eat(SB_RPAR);
   }
@@ -356,16 +555,16 @@ void compileParam(void) {
     paramKind = PARAM_REFERENCE;
     break;
   default:
-    error(ERR_INVALID_PARAMETER, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_PARAMETER, lookAhead);
     break;
   }
 
   eat(TK_IDENT);
-  checkFreshIdent(currentToken->string);
-  param = createParameterObject(currentToken->string, paramKind, symtab->currentScope->owner);
+  checkFreshIdent(currentToken->symbol);
+  param = createParameterObject(currentToken->symbol, paramKind, symtab->currentScope->owner);
   eat(SB_COLON);
   type = compileBasicType();
-  param->paramAttrs->type = type;
+  param->paramAttrs.type = type;
   declareObject(param);
 }
 
@@ -378,6 +577,10 @@ void compileStatements(void) {
 }
 
 void compileStatement(void) {
+  compileRecovering(compileStatement2, statementFollow);
+}
+
+void compileStatement2(void) {
   switch (lookAhead->tokenType) {
   case TK_IDENT:
     compileAssignSt();
@@ -404,31 +607,39 @@ void compileStatement(void) {
     break;
     // Error occurs
   default:
-    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_STATEMENT, lookAhead);
     break;
   }
 }
 
 Type* compileLValue(void) {
-  // TODO: parse a lvalue (a variable, an array element, a parameter, the current function identifier)
   Object* var;
   Type* varType;
 
   eat(TK_IDENT);
   // check if the identifier is a function identifier, or a variable identifier, or a parameter
-  var = checkDeclaredLValueIdent(currentToken->string);
-  if (var->kind == OBJ_VARIABLE)
-    compileIndexes();
+  var = checkDeclaredLValueIdent(currentToken->symbol);
+  switch (var->kind) {
+  case OBJ_VARIABLE:
+    varType = compileIndexes(var->varAttrs.type);
+    break;
+  case OBJ_PARAMETER:
+    varType = var->paramAttrs.type;
+    break;
+  default:
+    // the function being declared, assigned its result
+    varType = var->funcAttrs.returnType;
+  }
 
   return varType;
 }
 
-void compileAssignSt(void) {
-  Object* lvalue = compileLValue();
-  eat(SB_ASSIGN);
-  Type* expType = compileExpression();
-
-  checkTypeEquality(lvalue->varAttrs->type, expType);
+void compileAssignSt(void) {
+  Type* varType = compileLValue();
+  eat(SB_ASSIGN);
+  Type* expType = compileExpression();
+
+  checkTypeEquality(varType, expType);
 }
 
 void compileCallSt(void) {
@@ -437,9 +648,9 @@ void compileCallSt(void) {
   eat(KW_CALL);
   eat(TK_IDENT);
 
-  proc = checkDeclaredProcedure(currentToken->string);
+  proc = checkDeclaredProcedure(currentToken->symbol);
 
-  compileArguments(proc->procAttrs->paramList);
+  compileArguments(proc->procAttrs.paramList);
 }
 
 void compileGroupSt(void) {
@@ -470,43 +681,87 @@ void compileWhileSt(void) {
 }
 
 void compileForSt(void) {
-  eat(KW_FOR);
-  Object* var = compileVariable();
-  checkBasicType(var->varAttrs->type);
+  eat(KW_FOR);
+  eat(TK_IDENT);
+  Object* var = checkDeclaredVariable(currentToken->symbol);
+  checkBasicType(var->varAttrs.type);
 
   eat(SB_ASSIGN);
   Type* type1 = compileExpression();
-  checkTypeEquality(var->varAttrs->type, type1);
+  checkTypeEquality(var->varAttrs.type, type1);
 
   eat(KW_TO);
   Type* type2 = compileExpression();
-  checkTypeEquality(var->varAttrs->type, type2);
+  checkTypeEquality(var->varAttrs.type, type2);
 
   eat(KW_DO);
   compileStatement();
 }
 
 void compileArgument(Object* param) {
-  // TODO: parse an argument, and check type consistency
-  //       If the corresponding parameter is a reference, the argument must be a lvalue
-  compileExpression();
-}
-
-void compileArguments(Object* paramList) {
-  Object* p = paramList;
-  eat(SB_LPAR);
-  while (p != NULL) {
-    if (p->paramAttrs->kind == PARAM_REFERENCE) {
-      compileLValue();
-    } else {
-      Type* argType = compileExpression();
-      checkTypeEquality(argType, p->paramAttrs->type);
-    }
-
-    p = p->next;
-    if (p != NULL) eat(SB_COMMA);
-  }
-  eat(SB_RPAR);
+  Type* argType;
+
+  // a reference parameter takes a lvalue
+  if (param->paramAttrs.kind == PARAM_REFERENCE)
+    argType = compileLValue();
+  else argType = compileExpression();
+
+  checkTypeEquality(param->paramAttrs.type, argType);
+}
+
+void compileArguments(ObjectNode* paramList) {
+  ObjectNode* node = paramList;
+
+  switch (lookAhead->tokenType) {
+  case SB_LPAR:
+    eat(SB_LPAR);
+    if (node == NULL) {
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken);
+      return;
+    }
+    compileArgument(node->object);
+    node = node->next;
+
+    while (lookAhead->tokenType == SB_COMMA) {
+      eat(SB_COMMA);
+      if (node == NULL) {
+        error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken);
+        return;
+      }
+      compileArgument(node->object);
+      node = node->next;
+    }
+
+    if (node != NULL)
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken);
+    eat(SB_RPAR);
+    break;
+    // Check FOLLOW set
+  case SB_TIMES:
+  case SB_SLASH:
+  case SB_PLUS:
+  case SB_MINUS:
+  case KW_TO:
+  case KW_DO:
+  case SB_RPAR:
+  case SB_COMMA:
+  case SB_EQ:
+  case SB_NEQ:
+  case SB_LE:
+  case SB_LT:
+  case SB_GE:
+  case SB_GT:
+  case SB_RSEL:
+  case SB_SEMICOLON:
+  case KW_END:
+  case KW_ELSE:
+  case KW_THEN:
+    if (node != NULL)
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, lookAhead);
+    break;
+  default:
+    error(ERR_INVALID_ARGUMENTS, lookAhead);
+  }
 }
 
 void compileCondition(void) {
@@ -519,7 +774,7 @@ void compileCondition(void) {
       eat(lookAhead->tokenType);
       break;
     default:
-      error(ERR_INVALID_COMPARATOR, lookAhead->lineNo, lookAhead->colNo);
+      error(ERR_INVALID_COMPARATOR, lookAhead);
   }
 
   Type* type2 = compileExpression();
@@ -590,7 +845,9 @@ void compileExpression3(void) {
   case KW_THEN:
     break;
   default:
-    error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    // panic mode: resume at a token of the FOLLOW set above
+    reportError(ERR_INVALID_EXPRESSION, lookAhead);
+    skipTo(expressionFollow);
   }
 }
 
@@ -639,45 +896,51 @@ void compileTerm2(void) {
   case KW_THEN:
     break;
   default:
-    error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
+    reportError(ERR_INVALID_TERM, lookAhead);
+    skipTo(termFollow);
   }
 }
 
 Type* compileFactor(void) {
-  // TODO: parse a factor and return the factor's type
-
   Object* obj;
-  Type* type;
+  Type* type = NULL;
 
   switch (lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
+    type = makeIntType();
     break;
   case TK_CHAR:
     eat(TK_CHAR);
+    type = makeCharType();
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredIdent(currentToken->string);
+    obj = checkDeclaredIdent(currentToken->symbol);
 
     switch (obj->kind) {
     case OBJ_CONSTANT:
+      if (obj->constAttrs.value.type == TP_INT)
+        type = makeIntType();
+      else type = makeCharType();
       break;
     case OBJ_VARIABLE:
-      compileIndexes();
+      type = compileIndexes(obj->varAttrs.type);
       break;
     case OBJ_PARAMETER:
+      type = obj->paramAttrs.type;
       break;
     case OBJ_FUNCTION:
-      compileArguments();
+      compileArguments(obj->funcAttrs.paramList);
+      type = obj->funcAttrs.returnType;
       break;
     default:
-      error(ERR_INVALID_FACTOR,currentToken->lineNo, currentToken->colNo);
+      error(ERR_INVALID_FACTOR,currentToken);
       break;
     }
     break;
   default:
-    error(ERR_INVALID_FACTOR, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_FACTOR, lookAhead);
   }
 
   return type;
@@ -691,30 +954,126 @@ Type* compileIndexes(Type* arrayType) {
     checkIntType(idxType);
     eat(SB_RSEL);
 
-    checkArrayType(type);
-    type = type->arrayAttrs->elementType;
+    checkArrayType(type);
+    type = type->elementType;
   }
   return type;
 }
 
+/* Returns the number of errors */
+int compileInput(void) {
+  jmp_buf stop;
+  int errors;
+
+  currentToken = NULL;
+  lookAhead = NULL;
+  initSymTab();
+
+  if (setjmp(stop) == 0) {
+    abortPoint = &stop;
+    lookAhead = nextToken();
+    compileRecovering(compileProgram, programFollow);
+  }
+  abortPoint = NULL;
+
+  // without batch mode, an error has already ended the compilation
+  errors = endDiagnostics();
+  if (errors == 0) {
+    if (!interfaceOnly)
+      printObject(symtab->program,0);
+    if (!saveSymbolImage())
+      printf("Can\'t write the symbol image!\n");
+    if (symtab->program->progAttrs.isUnit && sourceFileName != NULL && !saveUnitInterface(sourceFileName))
+      printf("Can\'t write the unit interface!\n");
+  }
+
+  cleanImports();
+  cleanSymTab();
+
+  freeToken(currentToken);
+  freeToken(lookAhead);
+  return errors;
+}
+
 int compile(char *fileName) {
   if (openInputStream(fileName) == IO_ERROR)
     return IO_ERROR;
 
-  currentToken = NULL;
-  lookAhead = getValidToken();
+  sourceFileName = fileName;
+  setDiagnosticFile(fileName);
+  compileInput();
+  sourceFileName = NULL;
+  setDiagnosticFile(NULL);
 
-  initSymTab();
+  closeInputStream();
+  return IO_SUCCESS;
+}
+
+/* Runs in a child process, on a copy of the state of the compilation
+   that imports the unit */
+int compileImportedUnit(char *fileName) {
+  cleanImports();
+  tokenStream = NULL;
+  interfaceOnly = 1;
+  resetDiagnostics();
+  setDiagnosticSink(NULL);
+  setSymbolImageOutput(NULL);
+  return compile(fileName);
+}
 
-  compileProgram();
+/* Compiles a program held by the caller; the buffer is only read and
+   need not end with '\0'. Batch mode is turned on for the compilation
+   if it is not, so an error never ends the process. Returns IO_SUCCESS,
+   COMPILE_ERROR after errors, or IO_ERROR for a buffer too long to
+   read. */
+int compileBuffer(const char *source, size_t length) {
+  int batch = inBatchMode();
+  int errors;
 
-  printObject(symtab->program,0);
+  if (length > INT_MAX)
+    return IO_ERROR;
+  if (!batch)
+    beginDiagnostics(BUFFER_MAX_ERRORS);
 
-  cleanSymTab();
+  attachReader(&inputReader, source, (int) length);
+  errors = compileInput();
+  closeInputStream();
+
+  if (!batch)
+    endBatchMode();
+  return (errors == 0) ? IO_SUCCESS : COMPILE_ERROR;
+}
+
+/* The tokens of the whole source are kept, so the standard input is
+   read whole as well, for the positions of its tokens */
+int compileTokenized(char *fileName, int threadCount, int useCache) {
+  // the standard input has no file to keep a cache beside
+  if (strcmp(fileName, "-") == 0)
+    useCache = 0;
+  tokenStream = useCache ? loadTokenCache(fileName, &inputReader) : NULL;
 
-  free(currentToken);
-  free(lookAhead);
+  if (tokenStream == NULL) {
+    if (openReader(&inputReader, fileName) == IO_ERROR)
+      return IO_ERROR;
+
+    if (threadCount > 1)
+      tokenStream = tokenizeParallel(&inputReader, threadCount);
+    else tokenStream = tokenizeInput();
+
+    if (useCache)
+      saveTokenCache(fileName, tokenStream, &inputReader);
+  }
+
+  tokenCursor = 0;
+  sourceFileName = fileName;
+  setDiagnosticFile(fileName);
+  compileInput();
+  sourceFileName = NULL;
+  setDiagnosticFile(NULL);
+
+  // kept open until now, errors need its newline table
   closeInputStream();
+  freeTokenStream(tokenStream);
+  tokenStream = NULL;
   return IO_SUCCESS;
-
 }
@@ -5,6 +5,7 @@
  */
 #ifndef __PARSER_H__
 #define __PARSER_H__
+#include <stddef.h>
 #include "token.h"
 #include "symtab.h"
 
@@ -12,6 +13,8 @@ void scan(void);
 void eat(TokenType tokenType);
 
 void compileProgram(void);
+void compileImports(void);
+void compileImport(void);
 void compileBlock(void);
 void compileBlock2(void);
 void compileBlock3(void);
@@ -24,6 +27,9 @@ void compileTypeDecl(void);
 void compileVarDecls(void);
 void compileVarDecl(void);
 void compileSubDecls(void);
+void compileSubDecl(void);
+void compileFuncHeader(void);
+void compileProcHeader(void);
 void compileFuncDecl(void);
 void compileProcDecl(void);
 ConstantValue* compileUnsignedConstant(void);
@@ -35,6 +41,7 @@ void compileParams(void);
 void compileParam(void);
 void compileStatements(void);
 void compileStatement(void);
+void compileStatement2(void);
 Type* compileLValue(void);
 void compileAssignSt(void);
 void compileCallSt(void);
@@ -54,6 +61,13 @@ void compileTerm2(void);
 Type* compileFactor(void);
 Type* compileIndexes(Type* arrayType);
 
+/* Returned by compileBuffer for a program with errors */
+#define COMPILE_ERROR 2
+
 int compile(char *fileName);
+int compileBuffer(const char *source, size_t length);
+int compileTokenized(char *fileName, int threadCount, int useCache);
+int compileImportedUnit(char *fileName);
+void setStreaming(int on);
 
 #endif
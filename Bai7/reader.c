@@ -5,33 +5,248 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
 #include "reader.h"
 
-FILE *inputStream;
-int lineNo, colNo;
-int currentChar;
+#define READ_BLOCK_SIZE 65536
 
-int readChar(void) {
-  currentChar = getc(inputStream);
-  colNo ++;
-  if (currentChar == '\n') {
-    lineNo ++;
-    colNo = 0;
-  }
-  return currentChar;
+/* The whole source is kept in memory; only the offset of the current
+   character is tracked while reading. Lines and columns are computed
+   from offsets when someone asks for them. */
+Reader inputReader;
+
+int refillReader(Reader *reader);
+
+int readCharFrom(Reader *reader) {
+  reader->charNo ++;
+  if (reader->charNo < reader->sourceLength || 
+      (reader->input != NULL && refillReader(reader)))
+    reader->currentChar = (unsigned char) reader->source[reader->charNo - reader->sourceBase];
+  else reader->currentChar = EOF;
+  return reader->currentChar;
 }
 
-int openInputStream(char *fileName) {
-  inputStream = fopen(fileName, "rt");
-  if (inputStream == NULL)
+/* Reads from a buffer owned by the caller, which must outlive the
+   reader. A source the reader does not own is never written. */
+void attachReader(Reader *reader, const char *source, int length) {
+  reader->source = (char*) source;
+  reader->sourceBase = 0;
+  reader->sourceLength = length;
+  reader->ownsSource = 0;
+  reader->input = NULL;
+  reader->newlines = NULL;
+  reader->newlineCount = -1;
+  reader->newlineCapacity = 0;
+  reader->symbols = NULL;
+  reader->charNo = -1;
+  readCharFrom(reader);
+}
+
+/* Reads a whole file, "-" being the standard input read to its end */
+int openReader(Reader *reader, char *fileName) {
+  FILE *f = (strcmp(fileName, "-") == 0) ? stdin : fopen(fileName, "rb");
+  int capacity = READ_BLOCK_SIZE;
+  int length = 0;
+  char *source;
+  int n;
+
+  if (f == NULL)
     return IO_ERROR;
-  lineNo = 1;
-  colNo = 0;
-  readChar();
+
+  source = (char*) malloc(capacity);
+  while ((n = fread(source + length, 1, capacity - length, f)) > 0) {
+    length += n;
+    if (length == capacity) {
+      capacity *= 2;
+      source = (char*) realloc(source, capacity);
+    }
+  }
+  if (f != stdin)
+    fclose(f);
+
+  attachReader(reader, source, length);
+  reader->ownsSource = 1;
   return IO_SUCCESS;
 }
 
+/* Reads a descriptor the caller keeps open, holding at most two buffers
+   of it in memory */
+int openStreamReader(Reader *reader, int fd) {
+  StreamInput *input = (StreamInput*) calloc(1, sizeof(StreamInput));
+  int h;
+
+  input->fd = fd;
+  input->current = 1;
+  input->lineStart = -1;
+  input->tokenOffset = -1;
+  for (h = 0; h < 2; h++)
+    input->halves[h] = (char*) malloc(STREAM_HALF_SIZE);
+
+  attachReader(reader, input->halves[1], 0);
+  reader->input = input;
+  reader->charNo = -1;
+  readCharFrom(reader);
+  return IO_SUCCESS;
+}
+
+/* Counts the newlines of a streamed input up to offset, which must not
+   be past the bytes in the buffers */
+void countLines(StreamInput *input, int offset) {
+  int h, end;
+  char *p, *last;
+
+  while (input->counted < offset) {
+    h = (input->counted >= input->base[input->current]) ? input->current : 1 - input->current;
+    end = input->base[h] + input->filled[h];
+    if (end > offset)
+      end = offset;
+
+    p = input->halves[h] + (input->counted - input->base[h]);
+    last = input->halves[h] + (end - input->base[h]);
+    while ((p = memchr(p, '\n', last - p)) != NULL) {
+      input->lines ++;
+      input->lineStart = input->base[h] + (p - input->halves[h]);
+      p ++;
+    }
+    input->counted = end;
+  }
+}
+
+/* Fills the buffer not holding the current character with the bytes
+   one read gives, and makes it current. Its old bytes are counted
+   first. Returns 0 at the end of input. */
+int refillReader(Reader *reader) {
+  StreamInput *input = reader->input;
+  int last = input->current;
+  int next = 1 - last;
+  int filled = 0;
+
+  if (input->eof)
+    return 0;
+  countLines(input, input->base[last]);
+
+  do filled = read(input->fd, input->halves[next], STREAM_HALF_SIZE);
+  while (filled < 0 && errno == EINTR);
+  if (filled <= 0) {
+    input->eof = 1;
+    return 0;
+  }
+
+  input->base[next] = input->base[last] + input->filled[last];
+  input->filled[next] = filled;
+
+  input->current = next;
+  reader->source = input->halves[next];
+  reader->sourceBase = input->base[next];
+  reader->sourceLength = input->base[next] + filled;
+  return reader->charNo < reader->sourceLength;
+}
+
+void closeReader(Reader *reader) {
+  if (reader->input != NULL) {
+    free(reader->input->halves[0]);
+    free(reader->input->halves[1]);
+    free(reader->input);
+    reader->input = NULL;
+  }
+  else if (reader->ownsSource)
+    free(reader->source);
+  free(reader->newlines);
+  reader->source = NULL;
+  reader->newlines = NULL;
+  reader->newlineCount = -1;
+}
+
+void buildNewlineTable(Reader *reader) {
+  int capacity = 256;
+  char *p = reader->source;
+  char *end = reader->source + reader->sourceLength;
+  int *newlines = (int*) malloc(capacity * sizeof(int));
+  int count = 0;
+
+  // memchr is vectorized by the C library, so this is a SIMD scan
+  while ((p = memchr(p, '\n', end - p)) != NULL) {
+    if (count == capacity) {
+      capacity *= 2;
+      newlines = (int*) realloc(newlines, capacity * sizeof(int));
+    }
+    newlines[count++] = p - reader->source;
+    p ++;
+  }
+  reader->newlines = newlines;
+  reader->newlineCount = count;
+  reader->newlineCapacity = capacity;
+}
+
+/* A '\n' is reported at column 0 of the line after it, as the old
+   per-character counters did. A streamed input only knows the
+   positions from the last one asked for on. */
+void getReaderPosition(Reader *reader, int offset, int *lineNo, int *colNo) {
+  StreamInput *input = reader->input;
+  int lo = 0, hi;
+
+  if (input != NULL) {
+    countLines(input, (offset < reader->sourceLength) ? offset + 1 : reader->sourceLength);
+    *lineNo = input->lines + 1;
+    *colNo = offset - input->lineStart;
+    return;
+  }
+
+  if (reader->newlineCount < 0)
+    buildNewlineTable(reader);
+
+  // count the newlines at or before offset
+  hi = reader->newlineCount;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (reader->newlines[mid] <= offset) lo = mid + 1;
+    else hi = mid;
+  }
+
+  *lineNo = lo + 1;
+  *colNo = (lo == 0) ? offset + 1 : offset - reader->newlines[lo - 1];
+}
+
+/* Called by the scanner where a token may start; the bytes of a token
+   can be gone from a streamed input once it is read */
+void markTokenStart(Reader *reader) {
+  StreamInput *input = reader->input;
+
+  input->tokenOffset = reader->charNo;
+  getReaderPosition(reader, reader->charNo, &input->tokenLineNo, &input->tokenColNo);
+}
+
+/* The position of a token just read from a streamed input */
+void getTokenPosition(Reader *reader, int offset, int *lineNo, int *colNo) {
+  StreamInput *input = reader->input;
+
+  if (offset == input->tokenOffset) {
+    *lineNo = input->tokenLineNo;
+    *colNo = input->tokenColNo;
+  }
+  else getReaderPosition(reader, offset, lineNo, colNo);
+}
+
+/******************************************************************/
+
+int readChar(void) {
+  return readCharFrom(&inputReader);
+}
+
+/* "-" names the standard input, which is streamed */
+int openInputStream(char *fileName) {
+  if (strcmp(fileName, "-") == 0)
+    return openStreamReader(&inputReader, 0);
+  return openReader(&inputReader, fileName);
+}
+
 void closeInputStream() {
-  fclose(inputStream);
+  closeReader(&inputReader);
 }
 
+void getPosition(int offset, int *lineNo, int *colNo) {
+  getReaderPosition(&inputReader, offset, lineNo, colNo);
+}
@@ -7,11 +7,69 @@
 #ifndef __READER_H__
 #define __READER_H__
 
+#include "intern.h"
+
 #define IO_ERROR 0
 #define IO_SUCCESS 1
 
+#define STREAM_HALF_SIZE 65536
+
+/* Input read from a file descriptor through two buffers of up to
+   STREAM_HALF_SIZE bytes. When reading crosses the end of one, the other
+   is refilled with what one read gives, so the bytes just before the
+   current one stay available. There is no newline table: the newlines
+   before counted are counted, lines of them, the last one at lineStart,
+   and a buffer is counted before it is refilled. The scanner asks for
+   the position of each token start in order, and keeps it in the
+   token; tokenOffset is the last start it marked. */
+typedef struct {
+  int fd;
+  int eof;
+  int current;
+  char *halves[2];
+  int base[2];
+  int filled[2];
+  int counted;
+  int lines;
+  int lineStart;
+  int tokenOffset;
+  int tokenLineNo;
+  int tokenColNo;
+} StreamInput;
+
+/* Reading state of one source. Each thread lexing its own file uses
+   its own Reader; the functions without a Reader work on the global
+   one opened by openInputStream. source holds the bytes from offset
+   sourceBase up to sourceLength: the whole source, or the current
+   buffer of a streaming input. Identifiers are interned in symbols,
+   in the global table while it is NULL. */
+typedef struct {
+  char *source;
+  int sourceBase;
+  int sourceLength;
+  int ownsSource;
+  StreamInput *input;
+  int charNo;
+  int currentChar;
+  int *newlines;
+  int newlineCount;
+  int newlineCapacity;
+  InternTable *symbols;
+} Reader;
+
+int readCharFrom(Reader *reader);
+int openReader(Reader *reader, char *fileName);
+void attachReader(Reader *reader, const char *source, int length);
+int openStreamReader(Reader *reader, int fd);
+void closeReader(Reader *reader);
+void buildNewlineTable(Reader *reader);
+void getReaderPosition(Reader *reader, int offset, int *lineNo, int *colNo);
+void markTokenStart(Reader *reader);
+void getTokenPosition(Reader *reader, int offset, int *lineNo, int *colNo);
+
 int readChar(void);
 int openInputStream(char *fileName);
 void closeInputStream(void);
+void getPosition(int offset, int *lineNo, int *colNo);
 
 #endif
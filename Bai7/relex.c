@@ -0,0 +1,151 @@
+/* Incremental relexing
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "scanner.h"
+#include "relex.h"
+
+/* An editor keeps the token stream of a buffer and the Reader holding
+   the buffer. After an edit only the tokens around it are lexed again:
+   lexing restarts at the start of the first token that may have seen
+   the edited text, and stops as soon as the scanner stands at the
+   start of an old token lying wholly behind the edit. Token starts are
+   always outside comments, so both points are safe; see TokenStream.
+
+   Only the lexing is local. The source and the arrays of the stream
+   are flat, so each edit still moves everything behind it and shifts
+   its offsets, which takes time linear in the size of the file. */
+
+/* Replaces removedLength bytes at offset by text */
+void spliceSource(Reader *reader, int offset, int removedLength, char *text, int textLength) {
+  int tail = reader->sourceLength - offset - removedLength;
+  int length = reader->sourceLength - removedLength + textLength;
+  char *source = reader->source;
+
+  if (!reader->ownsSource) {
+    source = (char*) malloc(reader->sourceLength + 1);
+    memcpy(source, reader->source, reader->sourceLength);
+  }
+  // grow before moving the tail right, shrink after moving it left
+  if (length > reader->sourceLength)
+    source = (char*) realloc(source, length + 1);
+  memmove(source + offset + textLength, source + offset + removedLength, tail);
+  memcpy(source + offset, text, textLength);
+  if (length < reader->sourceLength)
+    source = (char*) realloc(source, length + 1);
+
+  free(reader->newlines);
+  reader->source = source;
+  reader->sourceLength = length;
+  reader->ownsSource = 1;
+  reader->newlines = NULL;
+  reader->newlineCount = -1;
+}
+
+/* Streams mapped from a token cache are copied to the heap before they
+   change size */
+void unmapStream(TokenStream *stream) {
+  TokenStream *copy = (TokenStream*) calloc(1, sizeof(TokenStream));
+  int n = stream->count;
+
+  while (copy->capacity < n)
+    growTokenStream(copy);
+  memcpy(copy->tokenTypes, stream->tokenTypes, n * sizeof(unsigned char));
+  memcpy(copy->starts, stream->starts, n * sizeof(int));
+  memcpy(copy->offsets, stream->offsets, n * sizeof(int));
+  memcpy(copy->lengths, stream->lengths, n * sizeof(int));
+  memcpy(copy->values, stream->values, n * sizeof(int));
+  copy->count = n;
+
+  munmap(stream->mapping, stream->mappingSize);
+  *stream = *copy;
+  free(copy);
+}
+
+/* Applies an edit of reader's source to the stream lexed from it */
+RelexResult relexEdit(TokenStream *stream, Reader *reader, 
+		      int offset, int removedLength, char *text, int textLength) {
+  RelexResult result;
+  TokenStream *fresh = (TokenStream*) calloc(1, sizeof(TokenStream));
+  Reader lexer;
+  Token *token;
+  int delta = textLength - removedLength;
+  int first, next, start, tail, count, i;
+  int lo = 0, hi = stream->count;
+
+  if (stream->mapping != NULL)
+    unmapStream(stream);
+  spliceSource(reader, offset, removedLength, text, textLength);
+
+  // a token has read up to the start of the next one, which it looked
+  // at to find its own end; so the last token starting before offset
+  // is the first one the edit may change
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (stream->starts[mid] < offset) lo = mid + 1;
+    else hi = mid;
+  }
+  first = (lo > 0) ? lo - 1 : 0;
+
+  attachReader(&lexer, reader->source, reader->sourceLength);
+  lexer.charNo = stream->starts[first] - 1;
+  readCharFrom(&lexer);
+
+  next = first;
+  while (1) {
+    start = lexer.charNo;
+    if (start >= offset + textLength) {
+      while (next < stream->count && 
+	     (stream->starts[next] < offset + removedLength || stream->starts[next] + delta < start))
+	next ++;
+      if (next < stream->count && stream->starts[next] + delta == start)
+	break;
+    }
+    token = getTokenFrom(&lexer);
+    appendToken(fresh, token, start, lexer.charNo);
+    free(token);
+    if (fresh->tokenTypes[fresh->count - 1] == TK_EOF) {
+      next = stream->count;
+      break;
+    }
+  }
+  closeReader(&lexer);
+
+  // old tokens [first, next) make room for the fresh ones
+  tail = stream->count - next;
+  count = first + fresh->count + tail;
+  while (stream->capacity < count)
+    growTokenStream(stream);
+
+  memmove(stream->tokenTypes + first + fresh->count, stream->tokenTypes + next, tail * sizeof(unsigned char));
+  memmove(stream->starts + first + fresh->count, stream->starts + next, tail * sizeof(int));
+  memmove(stream->offsets + first + fresh->count, stream->offsets + next, tail * sizeof(int));
+  memmove(stream->lengths + first + fresh->count, stream->lengths + next, tail * sizeof(int));
+  memmove(stream->values + first + fresh->count, stream->values + next, tail * sizeof(int));
+  for (i = first + fresh->count; i < count; i++) {
+    stream->starts[i] += delta;
+    stream->offsets[i] += delta;
+  }
+
+  if (fresh->count > 0) {
+    memcpy(stream->tokenTypes + first, fresh->tokenTypes, fresh->count * sizeof(unsigned char));
+    memcpy(stream->starts + first, fresh->starts, fresh->count * sizeof(int));
+    memcpy(stream->offsets + first, fresh->offsets, fresh->count * sizeof(int));
+    memcpy(stream->lengths + first, fresh->lengths, fresh->count * sizeof(int));
+    memcpy(stream->values + first, fresh->values, fresh->count * sizeof(int));
+  }
+
+  result.first = first;
+  result.removedTokens = next - first;
+  result.insertedTokens = fresh->count;
+  stream->count = count;
+
+  freeTokenStream(fresh);
+  return result;
+}
@@ -0,0 +1,26 @@
+/* Incremental relexing
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __RELEX_H__
+#define __RELEX_H__
+
+#include "reader.h"
+#include "tokenstream.h"
+
+/* Tokens [first, first + removedTokens) of the stream before an edit
+   were replaced by [first, first + insertedTokens) after it. Tokens
+   behind them are unchanged but for their positions. */
+typedef struct {
+  int first;
+  int removedTokens;
+  int insertedTokens;
+} RelexResult;
+
+/* The reader holds the whole source, it cannot be a streaming one */
+RelexResult relexEdit(TokenStream *stream, Reader *reader, 
+		      int offset, int removedLength, char *text, int textLength);
+
+#endif
@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
+#include <limits.h>
 
 #include "reader.h"
 #include "charcode.h"
@@ -15,23 +17,22 @@
 #include "scanner.h"
 
 
-extern int lineNo;
-extern int colNo;
-extern int currentChar;
+extern Reader inputReader;
 
 extern CharCode charCodes[];
 
 /***************************************************************/
 
-void skipBlank() {
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_SPACE))
-    readChar();
+void skipBlank(Reader *reader) {
+  while ((reader->currentChar != EOF) && (charCodes[reader->currentChar] == CHAR_SPACE))
+    readCharFrom(reader);
 }
 
-void skipComment() {
+/* Returns 0 when the input ends inside the comment */
+int skipComment(Reader *reader) {
   int state = 0;
-  while ((currentChar != EOF) && (state < 2)) {
-    switch (charCodes[currentChar]) {
+  while ((reader->currentChar != EOF) && (state < 2)) {
+    switch (charCodes[reader->currentChar]) {
     case CHAR_TIMES:
       state = 1;
       break;
@@ -42,198 +43,294 @@ void skipComment() {
     default:
       state = 0;
     }
-    readChar();
+    readCharFrom(reader);
   }
-  if (state != 2) 
-    error(ERR_END_OF_COMMENT, lineNo, colNo);
+  return (state == 2);
 }
 
-Token* readIdentKeyword(void) {
-  Token *token = makeToken(TK_NONE, lineNo, colNo);
+Token* readIdentKeyword(Reader *reader) {
+  Token *token = makeToken(TK_NONE, reader->charNo);
   int count = 1;
 
-  token->string[0] = toupper((char)currentChar);
-  readChar();
+  token->string[0] = toupper((char)reader->currentChar);
+  readCharFrom(reader);
 
-  while ((currentChar != EOF) && 
-	 ((charCodes[currentChar] == CHAR_LETTER) || (charCodes[currentChar] == CHAR_DIGIT))) {
-    if (count <= MAX_IDENT_LEN) token->string[count++] = toupper((char)currentChar);
-    readChar();
+  while ((reader->currentChar != EOF) && 
+	 ((charCodes[reader->currentChar] == CHAR_LETTER) || (charCodes[reader->currentChar] == CHAR_DIGIT))) {
+    if (count <= MAX_IDENT_LEN) token->string[count++] = toupper((char)reader->currentChar);
+    readCharFrom(reader);
   }
 
   if (count > MAX_IDENT_LEN) {
-    error(ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
+    token->value = ERR_IDENT_TOO_LONG;
     return token;
   }
 
   token->string[count] = '\0';
   token->tokenType = checkKeyword(token->string);
 
-  if (token->tokenType == TK_NONE)
+  if (token->tokenType == TK_NONE) {
     token->tokenType = TK_IDENT;
+    token->symbol = (reader->symbols == NULL) ? internSymbol(token->string) :
+      internSymbolIn(reader->symbols, token->string);
+    if (token->symbol == SYMBOL_NONE) {
+      token->tokenType = TK_NONE;
+      token->value = ERR_TOO_MANY_IDENTIFIERS;
+    }
+  }
 
   return token;
 }
 
-Token* readNumber(void) {
-  Token *token = makeToken(TK_NUMBER, lineNo, colNo);
+/* KPL integers are ints */
+#define MAX_NUMBER INT_MAX
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SWAR_DIGITS
+#endif
+
+#ifdef SWAR_DIGITS
+/* Whether the 8 bytes of word, first character lowest, are all digits */
+int isEightDigits(unsigned long long word) {
+  return ((word & 0xF0F0F0F0F0F0F0F0ULL) | 
+	  (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+/* Value of 8 digits: adjacent digits are combined into pairs, pairs
+   into groups of four, and those into the whole, one multiply each */
+unsigned int parseEightDigits(unsigned long long word) {
+  word = ((word & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+  word = ((word & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+  return (unsigned int) (((word & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+#endif
+
+/* The value is accumulated while reading; once it passes MAX_NUMBER it
+   stops growing and the token becomes an error */
+Token* readNumber(Reader *reader) {
+  Token *token = makeToken(TK_NUMBER, reader->charNo);
+  long long value = 0;
   int count = 0;
 
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_DIGIT)) {
-    token->string[count++] = (char)currentChar;
-    readChar();
+#ifdef SWAR_DIGITS
+  char *p = reader->source + (reader->charNo - reader->sourceBase);
+  int available = reader->sourceLength - reader->charNo;
+  unsigned long long word;
+
+  // whole words of digits, as far as the buffer holds them
+  while (available - count >= 8) {
+    memcpy(&word, p + count, 8);
+    if (!isEightDigits(word))
+      break;
+    if (count < MAX_IDENT_LEN)
+      memcpy(token->string + count, p + count, 
+	     (MAX_IDENT_LEN - count < 8) ? MAX_IDENT_LEN - count : 8);
+    if (value <= MAX_NUMBER)
+      value = value * 100000000 + parseEightDigits(word);
+    count += 8;
+  }
+  if (count > 0) {
+    reader->charNo += count - 1;
+    readCharFrom(reader);
+  }
+#endif
+
+  while ((reader->currentChar != EOF) && (charCodes[reader->currentChar] == CHAR_DIGIT)) {
+    if (count < MAX_IDENT_LEN)
+      token->string[count] = (char)reader->currentChar;
+    if (value <= MAX_NUMBER)
+      value = value * 10 + (reader->currentChar - '0');
+    count ++;
+    readCharFrom(reader);
   }
 
-  token->string[count] = '\0';
-  token->value = atoi(token->string);
+  if (value > MAX_NUMBER) {
+    token->tokenType = TK_NONE;
+    token->value = ERR_NUMBER_TOO_LARGE;
+    return token;
+  }
+
+  token->value = (int) value;
+  // leading zeros may make the spelling longer than the buffer
+  if (count <= MAX_IDENT_LEN)
+    token->string[count] = '\0';
+  else sprintf(token->string, "%d", token->value);
   return token;
 }
 
-Token* readConstChar(void) {
-  Token *token = makeToken(TK_CHAR, lineNo, colNo);
+Token* readConstChar(Reader *reader) {
+  Token *token = makeToken(TK_CHAR, reader->charNo);
 
-  readChar();
-  if (currentChar == EOF) {
+  readCharFrom(reader);
+  if (reader->currentChar == EOF) {
     token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    token->value = ERR_INVALID_CONSTANT_CHAR;
     return token;
   }
     
-  token->string[0] = currentChar;
+  token->string[0] = reader->currentChar;
   token->string[1] = '\0';
 
-  readChar();
-  if (currentChar == EOF) {
+  readCharFrom(reader);
+  if (reader->currentChar == EOF) {
     token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    token->value = ERR_INVALID_CONSTANT_CHAR;
     return token;
   }
 
-  if (charCodes[currentChar] == CHAR_SINGLEQUOTE) {
-    readChar();
+  if (charCodes[reader->currentChar] == CHAR_SINGLEQUOTE) {
+    readCharFrom(reader);
     return token;
   } else {
     token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    token->value = ERR_INVALID_CONSTANT_CHAR;
     return token;
   }
 }
 
-Token* getToken(void) {
+Token* readToken(Reader *reader) {
   Token *token;
-  int ln, cn;
+  int off;
+
+  if (reader->input != NULL)
+    markTokenStart(reader);
 
-  if (currentChar == EOF) 
-    return makeToken(TK_EOF, lineNo, colNo);
+  if (reader->currentChar == EOF) 
+    return makeToken(TK_EOF, reader->charNo);
 
-  switch (charCodes[currentChar]) {
-  case CHAR_SPACE: skipBlank(); return getToken();
-  case CHAR_LETTER: return readIdentKeyword();
-  case CHAR_DIGIT: return readNumber();
+  switch (charCodes[reader->currentChar]) {
+  case CHAR_SPACE: skipBlank(reader); return readToken(reader);
+  case CHAR_LETTER: return readIdentKeyword(reader);
+  case CHAR_DIGIT: return readNumber(reader);
   case CHAR_PLUS: 
-    token = makeToken(SB_PLUS, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_PLUS, reader->charNo);
+    readCharFrom(reader); 
     return token;
   case CHAR_MINUS:
-    token = makeToken(SB_MINUS, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_MINUS, reader->charNo);
+    readCharFrom(reader); 
     return token;
   case CHAR_TIMES:
-    token = makeToken(SB_TIMES, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_TIMES, reader->charNo);
+    readCharFrom(reader); 
     return token;
   case CHAR_SLASH:
-    token = makeToken(SB_SLASH, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_SLASH, reader->charNo);
+    readCharFrom(reader); 
     return token;
   case CHAR_LT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_LE, ln, cn);
-    } else return makeToken(SB_LT, ln, cn);
+    off = reader->charNo;
+    readCharFrom(reader);
+    if ((reader->currentChar != EOF) && (charCodes[reader->currentChar] == CHAR_EQ)) {
+      readCharFrom(reader);
+      return makeToken(SB_LE, off);
+    } else return makeToken(SB_LT, off);
   case CHAR_GT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_GE, ln, cn);
-    } else return makeToken(SB_GT, ln, cn);
+    off = reader->charNo;
+    readCharFrom(reader);
+    if ((reader->currentChar != EOF) && (charCodes[reader->currentChar] == CHAR_EQ)) {
+      readCharFrom(reader);
+      return makeToken(SB_GE, off);
+    } else return makeToken(SB_GT, off);
   case CHAR_EQ: 
-    token = makeToken(SB_EQ, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_EQ, reader->charNo);
+    readCharFrom(reader); 
     return token;
   case CHAR_EXCLAIMATION:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_NEQ, ln, cn);
+    off = reader->charNo;
+    readCharFrom(reader);
+    if ((reader->currentChar != EOF) && (charCodes[reader->currentChar] == CHAR_EQ)) {
+      readCharFrom(reader);
+      return makeToken(SB_NEQ, off);
     } else {
-      token = makeToken(TK_NONE, ln, cn);
-      error(ERR_INVALID_SYMBOL, ln, cn);
+      token = makeToken(TK_NONE, off);
+      token->value = ERR_INVALID_SYMBOL;
       return token;
     }
   case CHAR_COMMA:
-    token = makeToken(SB_COMMA, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_COMMA, reader->charNo);
+    readCharFrom(reader); 
     return token;
   case CHAR_PERIOD:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_RPAR)) {
-      readChar();
-      return makeToken(SB_RSEL, ln, cn);
-    } else return makeToken(SB_PERIOD, ln, cn);
+    off = reader->charNo;
+    readCharFrom(reader);
+    if ((reader->currentChar != EOF) && (charCodes[reader->currentChar] == CHAR_RPAR)) {
+      readCharFrom(reader);
+      return makeToken(SB_RSEL, off);
+    } else return makeToken(SB_PERIOD, off);
   case CHAR_SEMICOLON:
-    token = makeToken(SB_SEMICOLON, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_SEMICOLON, reader->charNo);
+    readCharFrom(reader); 
     return token;
   case CHAR_COLON:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_ASSIGN, ln, cn);
-    } else return makeToken(SB_COLON, ln, cn);
-  case CHAR_SINGLEQUOTE: return readConstChar();
+    off = reader->charNo;
+    readCharFrom(reader);
+    if ((reader->currentChar != EOF) && (charCodes[reader->currentChar] == CHAR_EQ)) {
+      readCharFrom(reader);
+      return makeToken(SB_ASSIGN, off);
+    } else return makeToken(SB_COLON, off);
+  case CHAR_SINGLEQUOTE: return readConstChar(reader);
   case CHAR_LPAR:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
+    off = reader->charNo;
+    readCharFrom(reader);
 
-    if (currentChar == EOF) 
-      return makeToken(SB_LPAR, ln, cn);
+    if (reader->currentChar == EOF) 
+      return makeToken(SB_LPAR, off);
 
-    switch (charCodes[currentChar]) {
+    switch (charCodes[reader->currentChar]) {
     case CHAR_PERIOD:
-      readChar();
-      return makeToken(SB_LSEL, ln, cn);
+      readCharFrom(reader);
+      return makeToken(SB_LSEL, off);
     case CHAR_TIMES:
-      readChar();
-      skipComment();
-      return getToken();
+      readCharFrom(reader);
+      if (!skipComment(reader)) {
+	token = makeToken(TK_NONE, reader->charNo);
+	token->value = ERR_END_OF_COMMENT;
+	return token;
+      }
+      return readToken(reader);
     default:
-      return makeToken(SB_LPAR, ln, cn);
+      return makeToken(SB_LPAR, off);
     }
   case CHAR_RPAR:
-    token = makeToken(SB_RPAR, lineNo, colNo);
-    readChar(); 
+    token = makeToken(SB_RPAR, reader->charNo);
+    readCharFrom(reader); 
     return token;
   default:
-    token = makeToken(TK_NONE, lineNo, colNo);
-    error(ERR_INVALID_SYMBOL, lineNo, colNo);
-    readChar(); 
+    token = makeToken(TK_NONE, reader->charNo);
+    token->value = ERR_INVALID_SYMBOL;
+    readCharFrom(reader); 
     return token;
   }
 }
 
+/* Skips invalid tokens without reporting them */
+/* Lexical errors come back as TK_NONE tokens whose value is the
+   ErrorCode, so lexing never prints or exits */
+Token* getTokenFrom(Reader *reader) {
+  Token *token = readToken(reader);
+
+  if (reader->input != NULL)
+    getTokenPosition(reader, token->offset, &token->lineNo, &token->colNo);
+  return token;
+}
+
+Token* getValidTokenFrom(Reader *reader) {
+  Token *token = getTokenFrom(reader);
+  while (token->tokenType == TK_NONE) {
+    free(token);
+    token = getTokenFrom(reader);
+  }
+  return token;
+}
+
+Token* getToken(void) {
+  Token *token = getTokenFrom(&inputReader);
+  if (token->tokenType == TK_NONE)
+    reportError((ErrorCode) token->value, token);
+  return token;
+}
+
 Token* getValidToken(void) {
   Token *token = getToken();
   while (token->tokenType == TK_NONE) {
@@ -246,57 +343,85 @@ Token* getValidToken(void) {
 
 /******************************************************************/
 
+/* Names printed by printToken, indexed by TokenType */
+char *tokenNames[] = {
+  [TK_NONE] = "TK_NONE", [TK_IDENT] = "TK_IDENT", [TK_NUMBER] = "TK_NUMBER",
+  [TK_CHAR] = "TK_CHAR", [TK_EOF] = "TK_EOF",
+
+  [KW_PROGRAM] = "KW_PROGRAM", [KW_CONST] = "KW_CONST", [KW_TYPE] = "KW_TYPE",
+  [KW_VAR] = "KW_VAR", [KW_INTEGER] = "KW_INTEGER", [KW_CHAR] = "KW_CHAR",
+  [KW_ARRAY] = "KW_ARRAY", [KW_OF] = "KW_OF", [KW_FUNCTION] = "KW_FUNCTION",
+  [KW_PROCEDURE] = "KW_PROCEDURE", [KW_BEGIN] = "KW_BEGIN", [KW_END] = "KW_END",
+  [KW_CALL] = "KW_CALL", [KW_IF] = "KW_IF", [KW_THEN] = "KW_THEN",
+  [KW_ELSE] = "KW_ELSE", [KW_WHILE] = "KW_WHILE", [KW_DO] = "KW_DO",
+  [KW_FOR] = "KW_FOR", [KW_TO] = "KW_TO", [KW_UNIT] = "KW_UNIT",
+  [KW_IMPORT] = "KW_IMPORT",
+
+  [SB_SEMICOLON] = "SB_SEMICOLON", [SB_COLON] = "SB_COLON", [SB_PERIOD] = "SB_PERIOD",
+  [SB_COMMA] = "SB_COMMA", [SB_ASSIGN] = "SB_ASSIGN", [SB_EQ] = "SB_EQ",
+  [SB_NEQ] = "SB_NEQ", [SB_LT] = "SB_LT", [SB_LE] = "SB_LE", [SB_GT] = "SB_GT",
+  [SB_GE] = "SB_GE", [SB_PLUS] = "SB_PLUS", [SB_MINUS] = "SB_MINUS",
+  [SB_TIMES] = "SB_TIMES", [SB_SLASH] = "SB_SLASH", [SB_LPAR] = "SB_LPAR",
+  [SB_RPAR] = "SB_RPAR", [SB_LSEL] = "SB_LSEL", [SB_RSEL] = "SB_RSEL"
+};
+
+/* Writes n in decimal at p and returns the position after it */
+char* formatInt(char *p, int n) {
+  char digits[12];
+  unsigned int u = (n < 0) ? -(unsigned int) n : (unsigned int) n;
+  int i = 0;
+
+  if (n < 0)
+    *p++ = '-';
+  do {
+    digits[i++] = '0' + u % 10;
+    u /= 10;
+  } while (u > 0);
+  while (i > 0)
+    *p++ = digits[--i];
+  return p;
+}
+
+char* appendText(char *p, char *text) {
+  while (*text != '\0')
+    *p++ = *text++;
+  return p;
+}
+
+/* Each token is built into one line and handed to the stdout buffer
+   with a single fwrite; dumps of large inputs were dominated by printf */
 void printToken(Token *token) {
+  char line[64 + MAX_IDENT_LEN];
+  char *p = line;
+  int lineNo, colNo;
 
-  printf("%d-%d:", token->lineNo, token->colNo);
+  if (token->lineNo > 0) {
+    lineNo = token->lineNo;
+    colNo = token->colNo;
+  }
+  else getPosition(token->offset, &lineNo, &colNo);
+  p = formatInt(p, lineNo);
+  *p++ = '-';
+  p = formatInt(p, colNo);
+  *p++ = ':';
+  p = appendText(p, tokenNames[token->tokenType]);
 
   switch (token->tokenType) {
-  case TK_NONE: printf("TK_NONE\n"); break;
-  case TK_IDENT: printf("TK_IDENT(%s)\n", token->string); break;
-  case TK_NUMBER: printf("TK_NUMBER(%s)\n", token->string); break;
-  case TK_CHAR: printf("TK_CHAR(\'%s\')\n", token->string); break;
-  case TK_EOF: printf("TK_EOF\n"); break;
-
-  case KW_PROGRAM: printf("KW_PROGRAM\n"); break;
-  case KW_CONST: printf("KW_CONST\n"); break;
-  case KW_TYPE: printf("KW_TYPE\n"); break;
-  case KW_VAR: printf("KW_VAR\n"); break;
-  case KW_INTEGER: printf("KW_INTEGER\n"); break;
-  case KW_CHAR: printf("KW_CHAR\n"); break;
-  case KW_ARRAY: printf("KW_ARRAY\n"); break;
-  case KW_OF: printf("KW_OF\n"); break;
-  case KW_FUNCTION: printf("KW_FUNCTION\n"); break;
-  case KW_PROCEDURE: printf("KW_PROCEDURE\n"); break;
-  case KW_BEGIN: printf("KW_BEGIN\n"); break;
-  case KW_END: printf("KW_END\n"); break;
-  case KW_CALL: printf("KW_CALL\n"); break;
-  case KW_IF: printf("KW_IF\n"); break;
-  case KW_THEN: printf("KW_THEN\n"); break;
-  case KW_ELSE: printf("KW_ELSE\n"); break;
-  case KW_WHILE: printf("KW_WHILE\n"); break;
-  case KW_DO: printf("KW_DO\n"); break;
-  case KW_FOR: printf("KW_FOR\n"); break;
-  case KW_TO: printf("KW_TO\n"); break;
-
-  case SB_SEMICOLON: printf("SB_SEMICOLON\n"); break;
-  case SB_COLON: printf("SB_COLON\n"); break;
-  case SB_PERIOD: printf("SB_PERIOD\n"); break;
-  case SB_COMMA: printf("SB_COMMA\n"); break;
-  case SB_ASSIGN: printf("SB_ASSIGN\n"); break;
-  case SB_EQ: printf("SB_EQ\n"); break;
-  case SB_NEQ: printf("SB_NEQ\n"); break;
-  case SB_LT: printf("SB_LT\n"); break;
-  case SB_LE: printf("SB_LE\n"); break;
-  case SB_GT: printf("SB_GT\n"); break;
-  case SB_GE: printf("SB_GE\n"); break;
-  case SB_PLUS: printf("SB_PLUS\n"); break;
-  case SB_MINUS: printf("SB_MINUS\n"); break;
-  case SB_TIMES: printf("SB_TIMES\n"); break;
-  case SB_SLASH: printf("SB_SLASH\n"); break;
-  case SB_LPAR: printf("SB_LPAR\n"); break;
-  case SB_RPAR: printf("SB_RPAR\n"); break;
-  case SB_LSEL: printf("SB_LSEL\n"); break;
-  case SB_RSEL: printf("SB_RSEL\n"); break;
+  case TK_IDENT: 
+  case TK_NUMBER:
+    *p++ = '(';
+    p = appendText(p, token->string);
+    *p++ = ')';
+    break;
+  case TK_CHAR:
+    p = appendText(p, "(\'");
+    p = appendText(p, token->string);
+    p = appendText(p, "\')");
+    break;
+  default: 
+    break;
   }
+  *p++ = '\n';
+  fwrite(line, 1, p - line, stdout);
 }
 
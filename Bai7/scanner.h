@@ -8,7 +8,11 @@
 #define __SCANNER_H__
 
 #include "token.h"
+#include "reader.h"
 
+int skipComment(Reader *reader);
+Token* getTokenFrom(Reader *reader);
+Token* getValidTokenFrom(Reader *reader);
 Token* getToken(void);
 Token* getValidToken(void);
 void printToken(Token *token);
@@ -5,94 +5,107 @@
  */
 
 #include <stdlib.h>
-#include <string.h>
 #include "semantics.h"
 #include "error.h"
 
 extern SymTab* symtab;
 extern Token* currentToken;
 
-Object* lookupObject(char *name) {
+Object* lookupObject(SymbolId symbol) {
   Scope* scope = symtab->currentScope;
-  Object* obj;
+  Object* obj = NULL;
+  int chainLength = 0;
 
+  symtabStats.lookups[STATS_LEVEL(scope->level)] ++;
   while (scope != NULL) {
-    obj = findObject(scope->objList, name);
-    if (obj != NULL) return obj;
+    chainLength ++;
+    obj = findScopeObject(scope, symbol);
+    if (obj != NULL) break;
     scope = scope->outer;
   }
-  obj = findObject(symtab->globalObjectList, name);
-  if (obj != NULL) return obj;
-  return NULL;
+  symtabStats.chainLengths[STATS_LEVEL(chainLength)] ++;
+
+  if (obj == NULL)
+    symtabStats.failedLookups ++;
+  return obj;
+}
+
+void checkFreshIdent(SymbolId symbol) {
+  if (findScopeObject(symtab->currentScope, symbol) != NULL)
+    error(ERR_DUPLICATE_IDENT, currentToken);
 }
 
-void checkFreshIdent(char *name) {
-  if (findObject(symtab->currentScope->objList, name) != NULL)
-    error(ERR_DUPLICATE_IDENT, currentToken->lineNo, currentToken->colNo);
+/* Like checkFreshIdent, but the compilation goes on after reporting a
+   duplicate; returns 0 for one */
+int checkFreshSubprogram(SymbolId symbol) {
+  if (findScopeObject(symtab->currentScope, symbol) == NULL)
+    return 1;
+  reportError(ERR_DUPLICATE_IDENT, currentToken);
+  return 0;
 }
 
-Object* checkDeclaredIdent(char* name) {
-  Object* obj = lookupObject(name);
+Object* checkDeclaredIdent(SymbolId symbol) {
+  Object* obj = lookupObject(symbol);
   if (obj == NULL) {
-    error(ERR_UNDECLARED_IDENT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_IDENT,currentToken);
   }
   return obj;
 }
 
-Object* checkDeclaredConstant(char* name) {
-  Object* obj = lookupObject(name);
+Object* checkDeclaredConstant(SymbolId symbol) {
+  Object* obj = lookupObject(symbol);
   if (obj == NULL)
-    error(ERR_UNDECLARED_CONSTANT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_CONSTANT,currentToken);
   if (obj->kind != OBJ_CONSTANT)
-    error(ERR_INVALID_CONSTANT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_CONSTANT,currentToken);
 
   return obj;
 }
 
-Object* checkDeclaredType(char* name) {
-  Object* obj = lookupObject(name);
+Object* checkDeclaredType(SymbolId symbol) {
+  Object* obj = lookupObject(symbol);
   if (obj == NULL)
-    error(ERR_UNDECLARED_TYPE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_TYPE,currentToken);
   if (obj->kind != OBJ_TYPE)
-    error(ERR_INVALID_TYPE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_TYPE,currentToken);
 
   return obj;
 }
 
-Object* checkDeclaredVariable(char* name) {
-  Object* obj = lookupObject(name);
+Object* checkDeclaredVariable(SymbolId symbol) {
+  Object* obj = lookupObject(symbol);
   if (obj == NULL)
-    error(ERR_UNDECLARED_VARIABLE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_VARIABLE,currentToken);
   if (obj->kind != OBJ_VARIABLE)
-    error(ERR_INVALID_VARIABLE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_VARIABLE,currentToken);
 
   return obj;
 }
 
-Object* checkDeclaredFunction(char* name) {
-  Object* obj = lookupObject(name);
+Object* checkDeclaredFunction(SymbolId symbol) {
+  Object* obj = lookupObject(symbol);
   if (obj == NULL)
-    error(ERR_UNDECLARED_FUNCTION,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_FUNCTION,currentToken);
   if (obj->kind != OBJ_FUNCTION)
-    error(ERR_INVALID_FUNCTION,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_FUNCTION,currentToken);
 
   return obj;
 }
 
-Object* checkDeclaredProcedure(char* name) {
-  Object* obj = lookupObject(name);
+Object* checkDeclaredProcedure(SymbolId symbol) {
+  Object* obj = lookupObject(symbol);
   if (obj == NULL)
-    error(ERR_UNDECLARED_PROCEDURE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_PROCEDURE,currentToken);
   if (obj->kind != OBJ_PROCEDURE)
-    error(ERR_INVALID_PROCEDURE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_PROCEDURE,currentToken);
 
   return obj;
 }
 
-Object* checkDeclaredLValueIdent(char* name) {
-  Object* obj = lookupObject(name);
+Object* checkDeclaredLValueIdent(SymbolId symbol) {
+  Object* obj = lookupObject(symbol);
   if (obj == NULL)
-    error(ERR_UNDECLARED_IDENT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_IDENT,currentToken);
 
   switch (obj->kind) {
   case OBJ_VARIABLE:
@@ -100,10 +113,10 @@ Object* checkDeclaredLValueIdent(char* name) {
     break;
   case OBJ_FUNCTION:
     if (obj != symtab->currentScope->owner)
-      error(ERR_INVALID_IDENT,currentToken->lineNo, currentToken->colNo);
+      error(ERR_INVALID_IDENT,currentToken);
     break;
   default:
-    error(ERR_INVALID_IDENT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_IDENT,currentToken);
   }
 
   return obj;
@@ -112,31 +125,31 @@ Object* checkDeclaredLValueIdent(char* name) {
 
 void checkIntType(Type* type) {
   if (type->typeClass != TP_INT) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, currentToken);
   }
 }
 
 void checkCharType(Type* type) {
   if (type->typeClass != TP_CHAR) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, currentToken);
   }
 }
 
 void checkBasicType(Type* type) {
   if (type->typeClass != TP_CHAR && type->typeClass != TP_INT) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, currentToken);
   }
 }
 
 void checkArrayType(Type* type) {
   if (type->typeClass != TP_ARRAY || type->elementType == NULL) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, currentToken);
   }
 }
 
 void checkTypeEquality(Type* type1, Type* type2) {
   if(!compareType(type1, type2)) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, currentToken);
   }
 }
 
@@ -9,14 +9,15 @@
 
 #include "symtab.h"
 
-void checkFreshIdent(char *name);
-Object* checkDeclaredIdent(char *name);
-Object* checkDeclaredConstant(char *name);
-Object* checkDeclaredType(char *name);
-Object* checkDeclaredVariable(char *name);
-Object* checkDeclaredFunction(char *name);
-Object* checkDeclaredProcedure(char *name);
-Object* checkDeclaredLValueIdent(char *name);
+void checkFreshIdent(SymbolId symbol);
+int checkFreshSubprogram(SymbolId symbol);
+Object* checkDeclaredIdent(SymbolId symbol);
+Object* checkDeclaredConstant(SymbolId symbol);
+Object* checkDeclaredType(SymbolId symbol);
+Object* checkDeclaredVariable(SymbolId symbol);
+Object* checkDeclaredFunction(SymbolId symbol);
+Object* checkDeclaredProcedure(SymbolId symbol);
+Object* checkDeclaredLValueIdent(SymbolId symbol);
 
 void checkIntType(Type* type);
 void checkCharType(Type* type);
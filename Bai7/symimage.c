@@ -0,0 +1,474 @@
+/* Symbol image
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "symtab.h"
+#include "symimage.h"
+#include "tokencache.h"
+
+extern SymTab* symtab;
+
+#define IMAGE_MAGIC "KPLS"
+#define IMAGE_VERSION 2
+
+/* Types are numbered with INTEGER 0, CHAR 1 and the array types of the
+   image from 2 on, each after its element type */
+#define IMAGE_INT_TYPE 0
+#define IMAGE_CHAR_TYPE 1
+#define IMAGE_FIRST_ARRAY_TYPE 2
+
+/* The image mapped for the whole run, if any, and the hash of its bytes */
+SymbolImage *prelude = NULL;
+unsigned long long preludeKey = 0;
+
+char *imageOutput = NULL;
+
+int validImageType(int type, int typeCount) {
+  return type >= 0 && type < typeCount + IMAGE_FIRST_ARRAY_TYPE;
+}
+
+int validImageName(int name, ImageHeader *header) {
+  return name >= 0 && name < header->namesSize;
+}
+
+/* Checks every index of the image once, so declaring its objects
+   needs no checks */
+int validImage(SymbolImage *image) {
+  ImageHeader *header = image->header;
+  ImageObject *obj;
+  int i, j;
+
+  for (i = 0; i < header->typeCount; i++)
+    if (image->types[i].arraySize < 0 || !validImageType(image->types[i].elementType, i))
+      return 0;
+
+  for (i = 0; i < header->objectCount; i++) {
+    obj = &(image->objects[i]);
+    if (!validImageName(obj->name, header))
+      return 0;
+    switch (obj->kind) {
+    case OBJ_CONSTANT:
+      if (obj->type != TP_INT && obj->type != TP_CHAR)
+	return 0;
+      break;
+    case OBJ_TYPE:
+      if (!validImageType(obj->type, header->typeCount))
+	return 0;
+      break;
+    case OBJ_FUNCTION:
+    case OBJ_PROCEDURE:
+      if ((obj->kind == OBJ_FUNCTION && !validImageType(obj->type, header->typeCount)) ||
+	  obj->value < 0 || obj->value > header->objectCount - i - 1)
+	return 0;
+      for (j = 1; j <= obj->value; j++)
+	if (obj[j].kind != OBJ_PARAMETER || !validImageName(obj[j].name, header) ||
+	    !validImageType(obj[j].type, header->typeCount) ||
+	    (obj[j].value != PARAM_VALUE && obj[j].value != PARAM_REFERENCE))
+	  return 0;
+      i += obj->value;
+      break;
+    default:
+      return 0;
+    }
+  }
+
+  for (i = 0; i < header->importCount; i++)
+    if (!validImageName(image->imports[i], header))
+      return 0;
+  return 1;
+}
+
+/* Returns NULL if the file can't be read or isn't a valid image */
+SymbolImage* mapSymbolImage(char *fileName) {
+  struct stat st;
+  ImageHeader *header;
+  SymbolImage *image;
+  char *data;
+  int fd;
+
+  fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) < 0 || st.st_size < sizeof(ImageHeader)) {
+    close(fd);
+    return NULL;
+  }
+  data = (char*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return NULL;
+
+  header = (ImageHeader*) data;
+  if (memcmp(header->magic, IMAGE_MAGIC, 4) != 0 ||
+      header->version != IMAGE_VERSION ||
+      header->typeCount < 0 || header->objectCount < 0 || header->importCount < 0 || header->namesSize < 0 ||
+      st.st_size != sizeof(ImageHeader) + header->typeCount * (long long) sizeof(ImageType)
+                    + header->objectCount * (long long) sizeof(ImageObject)
+                    + header->importCount * (long long) sizeof(int) + header->namesSize ||
+      (header->namesSize > 0 && data[st.st_size - 1] != '\0')) {
+    munmap(data, st.st_size);
+    return NULL;
+  }
+
+  image = (SymbolImage*) malloc(sizeof(SymbolImage));
+  image->header = header;
+  image->types = (ImageType*) (header + 1);
+  image->objects = (ImageObject*) (image->types + header->typeCount);
+  image->imports = (int*) (image->objects + header->objectCount);
+  image->names = (char*) (image->imports + header->importCount);
+  image->size = st.st_size;
+  if (!validImage(image)) {
+    unmapSymbolImage(image);
+    return NULL;
+  }
+  return image;
+}
+
+void unmapSymbolImage(SymbolImage *image) {
+  munmap(image->header, image->size);
+  free(image);
+}
+
+void declareImageParams(SymbolImage *image, Object* owner, ObjectNode ***paramTail, ImageObject *params, int paramCount, Type **types) {
+  Object* param;
+  int i;
+
+  for (i = 0; i < paramCount; i++) {
+    param = createParameterObject(internSymbol(image->names + params[i].name), params[i].value, owner);
+    param->paramAttrs.type = types[params[i].type];
+    addObject(paramTail, param);
+  }
+}
+
+/* Makes the objects of an image and declares them in scope. Returns 0,
+   declaring nothing, if scope or one outer to it already has an object
+   of one of their names. */
+int declareImage(SymbolImage *image, Scope* scope) {
+  ImageHeader *header = image->header;
+  Type** types;
+  ImageObject *rec;
+  Object* obj;
+  Scope* outer;
+  int i;
+
+  for (i = 0; i < header->objectCount; i++) {
+    rec = &(image->objects[i]);
+    for (outer = scope; outer != NULL; outer = outer->outer)
+      if (findScopeObject(outer, internSymbol(image->names + rec->name)) != NULL)
+	return 0;
+    if (rec->kind == OBJ_FUNCTION || rec->kind == OBJ_PROCEDURE)
+      i += rec->value;
+  }
+
+  types = (Type**) symtabAlloc((header->typeCount + IMAGE_FIRST_ARRAY_TYPE) * sizeof(Type*), ALLOC_TABLE);
+  types[IMAGE_INT_TYPE] = makeIntType();
+  types[IMAGE_CHAR_TYPE] = makeCharType();
+  for (i = 0; i < header->typeCount; i++)
+    types[IMAGE_FIRST_ARRAY_TYPE + i] = makeArrayType(image->types[i].arraySize, types[image->types[i].elementType]);
+
+  for (i = 0; i < header->objectCount; i++) {
+    rec = &(image->objects[i]);
+    switch (rec->kind) {
+    case OBJ_CONSTANT:
+      obj = createConstantObject(internSymbol(image->names + rec->name));
+      obj->constAttrs.value.type = rec->type;
+      if (rec->type == TP_INT)
+	obj->constAttrs.value.intValue = rec->value;
+      else obj->constAttrs.value.charValue = (char) rec->value;
+      break;
+    case OBJ_TYPE:
+      obj = createTypeObject(internSymbol(image->names + rec->name));
+      obj->typeAttrs.actualType = types[rec->type];
+      break;
+    case OBJ_FUNCTION:
+      obj = createFunctionObject(internSymbol(image->names + rec->name));
+      obj->funcAttrs.returnType = types[rec->type];
+      declareImageParams(image, obj, &(obj->funcAttrs.paramTail), rec + 1, rec->value, types);
+      i += rec->value;
+      break;
+    default:
+      obj = createProcedureObject(internSymbol(image->names + rec->name));
+      declareImageParams(image, obj, &(obj->procAttrs.paramTail), rec + 1, rec->value, types);
+      i += rec->value;
+      break;
+    }
+    addScopeObject(scope, obj);
+  }
+  return 1;
+}
+
+/* Maps an image for the compilations of this run. Returns 0 if the
+   file can't be read or isn't a valid image. */
+int loadSymbolImage(char *fileName) {
+  prelude = mapSymbolImage(fileName);
+  if (prelude == NULL)
+    return 0;
+  preludeKey = hashSource((unsigned char*) prelude->header, (int) prelude->size);
+  return 1;
+}
+
+int symbolImageMapped(void) {
+  return prelude != NULL;
+}
+
+/* What a unit's interface depends on, besides its source and imports,
+   when an image is mapped */
+unsigned long long symbolImageKey(void) {
+  return preludeKey;
+}
+
+/* Declares the objects of the mapped image in scope, once per run.
+   Returns 0 if no image is mapped. */
+int declareImageObjects(Scope* scope) {
+  if (prelude == NULL)
+    return 0;
+  declareImage(prelude, scope);
+  return 1;
+}
+
+/******************* Saving ******************************/
+
+/* The types written so far, in order, and an open addressing table of
+   their numbers by address */
+typedef struct {
+  Type **types;
+  int typeCount;
+  Type **table;
+  int *numbers;
+  int tableSize;
+} TypeNumbering;
+
+#define TYPE_SLOT(type, tableSize) ((((size_t) (type) >> 3) * 2654435761u) & ((tableSize) - 1))
+
+void growTypeNumbering(TypeNumbering *numbering) {
+  Type **oldTable = numbering->table;
+  int *oldNumbers = numbering->numbers;
+  int oldSize = numbering->tableSize;
+  int i;
+
+  numbering->tableSize = (oldSize == 0) ? 64 : 2 * oldSize;
+  numbering->table = (Type**) calloc(numbering->tableSize, sizeof(Type*));
+  numbering->numbers = (int*) malloc(numbering->tableSize * sizeof(int));
+  numbering->types = (Type**) realloc(numbering->types, numbering->tableSize / 2 * sizeof(Type*));
+  for (i = 0; i < oldSize; i++)
+    if (oldTable[i] != NULL) {
+      unsigned int slot = TYPE_SLOT(oldTable[i], numbering->tableSize);
+      while (numbering->table[slot] != NULL)
+	slot = (slot + 1) & (numbering->tableSize - 1);
+      numbering->table[slot] = oldTable[i];
+      numbering->numbers[slot] = oldNumbers[i];
+    }
+  free(oldTable);
+  free(oldNumbers);
+}
+
+/* The number of a type, giving one to it and its element types if
+   they have none yet */
+int typeNumber(TypeNumbering *numbering, Type* type) {
+  unsigned int slot;
+
+  if (type->typeClass == TP_INT)
+    return IMAGE_INT_TYPE;
+  if (type->typeClass == TP_CHAR)
+    return IMAGE_CHAR_TYPE;
+
+  if (numbering->tableSize > 0) {
+    slot = TYPE_SLOT(type, numbering->tableSize);
+    while (numbering->table[slot] != NULL) {
+      if (numbering->table[slot] == type)
+	return numbering->numbers[slot];
+      slot = (slot + 1) & (numbering->tableSize - 1);
+    }
+  }
+
+  // the element type is numbered, and written, first
+  typeNumber(numbering, type->elementType);
+  if (2 * (numbering->typeCount + 1) > numbering->tableSize)
+    growTypeNumbering(numbering);
+  slot = TYPE_SLOT(type, numbering->tableSize);
+  while (numbering->table[slot] != NULL)
+    slot = (slot + 1) & (numbering->tableSize - 1);
+  numbering->table[slot] = type;
+  numbering->numbers[slot] = IMAGE_FIRST_ARRAY_TYPE + numbering->typeCount;
+  numbering->types[numbering->typeCount++] = type;
+  return numbering->numbers[slot];
+}
+
+/* Records to write, grown as needed */
+typedef struct {
+  ImageObject *objects;
+  int count;
+  int capacity;
+  char *names;
+  int namesSize;
+  int namesCapacity;
+} ImageBuffer;
+
+/* Returns the offset of name in the names */
+int addImageName(ImageBuffer *buffer, char *name) {
+  int length = strlen(name) + 1;
+  int offset = buffer->namesSize;
+
+  while (buffer->namesSize + length > buffer->namesCapacity) {
+    buffer->namesCapacity = (buffer->namesCapacity == 0) ? 1024 : 2 * buffer->namesCapacity;
+    buffer->names = (char*) realloc(buffer->names, buffer->namesCapacity);
+  }
+  memcpy(buffer->names + offset, name, length);
+  buffer->namesSize += length;
+  return offset;
+}
+
+void addImageObject(ImageBuffer *buffer, Object* obj, int type, int value) {
+  ImageObject *rec;
+
+  if (buffer->count == buffer->capacity) {
+    buffer->capacity = (buffer->capacity == 0) ? 64 : 2 * buffer->capacity;
+    buffer->objects = (ImageObject*) realloc(buffer->objects, buffer->capacity * sizeof(ImageObject));
+  }
+
+  rec = &(buffer->objects[buffer->count++]);
+  rec->kind = obj->kind;
+  rec->name = addImageName(buffer, symbolName(obj->symbol));
+  rec->type = type;
+  rec->value = value;
+}
+
+int countObjects(ObjectNode *objList) {
+  int count = 0;
+
+  for (; objList != NULL; objList = objList->next)
+    count ++;
+  return count;
+}
+
+void addImageParams(ImageBuffer *buffer, TypeNumbering *numbering, ObjectNode *paramList) {
+  for (; paramList != NULL; paramList = paramList->next)
+    addImageObject(buffer, paramList->object,
+		   typeNumber(numbering, paramList->object->paramAttrs.type),
+		   paramList->object->paramAttrs.kind);
+}
+
+/* Variables have no storage outside of a program and are left out */
+void addImageObjects(ImageBuffer *buffer, TypeNumbering *numbering, ObjectNode *objList, Scope* shadowing) {
+  Object* obj;
+
+  for (; objList != NULL; objList = objList->next) {
+    obj = objList->object;
+    if (shadowing != NULL && findScopeObject(shadowing, obj->symbol) != NULL)
+      continue;
+
+    switch (obj->kind) {
+    case OBJ_CONSTANT:
+      addImageObject(buffer, obj, obj->constAttrs.value.type,
+		     (obj->constAttrs.value.type == TP_INT) ? obj->constAttrs.value.intValue : obj->constAttrs.value.charValue);
+      break;
+    case OBJ_TYPE:
+      addImageObject(buffer, obj, typeNumber(numbering, obj->typeAttrs.actualType), 0);
+      break;
+    case OBJ_FUNCTION:
+      addImageObject(buffer, obj, typeNumber(numbering, obj->funcAttrs.returnType), countObjects(obj->funcAttrs.paramList));
+      addImageParams(buffer, numbering, obj->funcAttrs.paramList);
+      break;
+    case OBJ_PROCEDURE:
+      addImageObject(buffer, obj, 0, countObjects(obj->procAttrs.paramList));
+      addImageParams(buffer, numbering, obj->procAttrs.paramList);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/* Writes the objects of the global scope globals and of the prelude
+   scope outer to it, if any, not redeclared in shadowing, then those
+   of declarations. Like the token cache, the image is written under
+   another name and renamed. Returns 0 if it can't be written. */
+int writeSymbolImage(char *fileName, Scope* globals, Scope* shadowing, ObjectNode *declarations,
+		     unsigned long long sourceHash, unsigned long long key, char **imports, int importCount) {
+  TypeNumbering numbering;
+  ImageBuffer buffer;
+  ImageHeader header;
+  ImageType type;
+  int *importNames;
+  char *tempName;
+  FILE *f;
+  int i, ok;
+
+  memset(&numbering, 0, sizeof(TypeNumbering));
+  memset(&buffer, 0, sizeof(ImageBuffer));
+  if (globals != NULL) {
+    if (globals->outer != NULL)
+      addImageObjects(&buffer, &numbering, globals->outer->objList, shadowing);
+    addImageObjects(&buffer, &numbering, globals->objList, shadowing);
+  }
+  addImageObjects(&buffer, &numbering, declarations, NULL);
+  importNames = (int*) malloc((importCount + 1) * sizeof(int));
+  for (i = 0; i < importCount; i++)
+    importNames[i] = addImageName(&buffer, imports[i]);
+
+  memset(&header, 0, sizeof(ImageHeader));
+  memcpy(header.magic, IMAGE_MAGIC, 4);
+  header.version = IMAGE_VERSION;
+  header.typeCount = numbering.typeCount;
+  header.objectCount = buffer.count;
+  header.importCount = importCount;
+  header.namesSize = buffer.namesSize;
+  header.sourceHash = sourceHash;
+  header.key = key;
+
+  tempName = (char*) malloc(strlen(fileName) + 32);
+  sprintf(tempName, "%s.%d", fileName, (int) getpid());
+  f = fopen(tempName, "wb");
+  ok = (f != NULL);
+  if (ok) {
+    fwrite(&header, sizeof(ImageHeader), 1, f);
+    for (i = 0; i < numbering.typeCount; i++) {
+      type.arraySize = numbering.types[i]->arraySize;
+      type.elementType = typeNumber(&numbering, numbering.types[i]->elementType);
+      fwrite(&type, sizeof(ImageType), 1, f);
+    }
+    fwrite(buffer.objects, sizeof(ImageObject), buffer.count, f);
+    fwrite(importNames, sizeof(int), importCount, f);
+    fwrite(buffer.names, 1, buffer.namesSize, f);
+    ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    if (ok)
+      ok = (rename(tempName, fileName) == 0);
+    if (!ok)
+      remove(tempName);
+  }
+
+  free(numbering.types);
+  free(numbering.table);
+  free(numbering.numbers);
+  free(buffer.objects);
+  free(buffer.names);
+  free(importNames);
+  free(tempName);
+  return ok;
+}
+
+void setSymbolImageOutput(char *fileName) {
+  imageOutput = fileName;
+}
+
+/* Writes the global objects, less those the program redeclares, and
+   the program's own declarations to the image output, if one was set.
+   Returns 0 if it can't be written. */
+int saveSymbolImage(void) {
+  Scope* programScope = symtab->program->progAttrs.scope;
+
+  if (imageOutput == NULL)
+    return 1;
+  return writeSymbolImage(imageOutput, symtab->globalScope, programScope, programScope->objList, 0, 0, NULL, 0);
+}
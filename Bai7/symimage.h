@@ -0,0 +1,72 @@
+/* Symbol image
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __SYMIMAGE_H__
+#define __SYMIMAGE_H__
+
+#include "symtab.h"
+
+/* Layout of an image: the header, the array types, the objects, the
+   imports and the names, each ending with '\0'. A function or
+   procedure is followed by the records of its parameters. */
+typedef struct {
+  char magic[4];
+  int version;
+  int typeCount;
+  int objectCount;
+  int importCount;
+  int namesSize;
+  // what the image was made from, for interfaces of units
+  unsigned long long sourceHash;
+  unsigned long long key;
+} ImageHeader;
+
+typedef struct {
+  int arraySize;
+  int elementType;
+} ImageType;
+
+/* type is the type of a type or a parameter, the return type of a
+   function or the type class of a constant's value; value is the
+   value of a constant, the parameter count of a subprogram or the
+   kind of a parameter */
+typedef struct {
+  int kind;
+  int name;
+  int type;
+  int value;
+} ImageObject;
+
+/* A mapped image; imports are offsets of names */
+typedef struct {
+  ImageHeader *header;
+  ImageType *types;
+  ImageObject *objects;
+  int *imports;
+  char *names;
+  size_t size;
+} SymbolImage;
+
+SymbolImage* mapSymbolImage(char *fileName);
+void unmapSymbolImage(SymbolImage *image);
+int declareImage(SymbolImage *image, Scope* scope);
+int writeSymbolImage(char *fileName, Scope* globals, Scope* shadowing, ObjectNode *declarations,
+		     unsigned long long sourceHash, unsigned long long key, char **imports, int importCount);
+
+/* The global objects and the constants, types and subprogram headers
+   declared by a program can be saved in a symbol image. A mapped image
+   takes the place of the built-in objects in every compilation after,
+   so a shared prelude is compiled only once. Its objects are made once
+   per run. */
+int loadSymbolImage(char *fileName);
+int symbolImageMapped(void);
+unsigned long long symbolImageKey(void);
+int declareImageObjects(Scope* scope);
+
+void setSymbolImageOutput(char *fileName);
+int saveSymbolImage(void);
+
+#endif
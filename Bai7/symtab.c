@@ -7,91 +7,156 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "arena.h"
 #include "symtab.h"
+#include "symimage.h"
 #include "error.h"
 
-void freeObject(Object* obj);
-void freeScope(Scope* scope);
-void freeObjectList(ObjectNode *objList);
-void freeReferenceList(ObjectNode *objList);
+/* Everything in the symbol table comes from these arenas and is
+   released together by cleanSymTab. Types, shared by all scopes, have
+   their own arena, so that releaseScope never takes one back. What is
+   made once per run, the primitive types and the prelude, comes from
+   a third arena that is kept. */
+Arena symtabArena = {NULL};
+Arena typeArena = {NULL};
+Arena preludeArena = {NULL};
+int makingPrelude = 0;
+
+SymTabStats symtabStats;
+
+/* All allocations of the symbol table, counted by kind */
+void* symtabAlloc(size_t size, enum AllocKind kind) {
+  symtabStats.bytes[kind] += size;
+  if (makingPrelude)
+    return arenaAlloc(&preludeArena, size);
+  if (kind == ALLOC_TYPE)
+    return arenaAlloc(&typeArena, size);
+  return arenaAlloc(&symtabArena, size);
+}
 
 SymTab* symtab;
 Type* intType;
 Type* charType;
 
+/* Array types already made, an open addressing table on (size, element
+   type) that is kept at most half full */
+#define INITIAL_ARRAY_TYPES 64
+
+Type** arrayTypes = NULL;
+int arrayTypeCount = 0;
+int arrayTypeTableSize = 0;
+
+/* The objects of the symbol image, if one is mapped, in a scope outer
+   to the global scope of every compilation, and the array types they
+   use, which are put back in the table of each compilation */
+Scope* preludeScope = NULL;
+Type** preludeTypes = NULL;
+int preludeTypeCount = 0;
+
 /******************* Type utilities ******************************/
 
+/* Types are never changed once made, so every type is made only once:
+   equal types are the same object */
+
 Type* makeIntType(void) {
-  Type* type = (Type*) malloc(sizeof(Type));
-  type->typeClass = TP_INT;
-  return type;
+  return intType;
 }
 
 Type* makeCharType(void) {
-  Type* type = (Type*) malloc(sizeof(Type));
-  type->typeClass = TP_CHAR;
+  return charType;
+}
+
+Type* makePrimitiveType(enum TypeClass typeClass) {
+  Type* type = (Type*) symtabAlloc(sizeof(Type), ALLOC_TYPE);
+  type->typeClass = typeClass;
+  type->arraySize = 0;
+  type->elementType = NULL;
   return type;
 }
 
+unsigned int arrayTypeSlot(int arraySize, Type* elementType, int tableSize) {
+  unsigned int h = (unsigned int) arraySize * 2654435761u ^ (unsigned int) ((size_t) elementType >> 3);
+  return (h * 2654435761u) & (tableSize - 1);
+}
+
+void insertArrayType(Type** table, int tableSize, Type* type) {
+  unsigned int slot = arrayTypeSlot(type->arraySize, type->elementType, tableSize);
+
+  while (table[slot] != NULL) {
+    slot = (slot + 1) & (tableSize - 1);
+    symtabStats.collisions ++;
+  }
+  table[slot] = type;
+}
+
+void growArrayTypes(void) {
+  int newSize = (arrayTypeTableSize == 0) ? INITIAL_ARRAY_TYPES : 2 * arrayTypeTableSize;
+  Type** newTable = (Type**) symtabAlloc(newSize * sizeof(Type*), ALLOC_TYPE);
+  int i;
+
+  memset(newTable, 0, newSize * sizeof(Type*));
+  for (i = 0; i < arrayTypeTableSize; i++)
+    if (arrayTypes[i] != NULL)
+      insertArrayType(newTable, newSize, arrayTypes[i]);
+
+  arrayTypes = newTable;
+  arrayTypeTableSize = newSize;
+}
+
+void addArrayType(Type* type) {
+  if (2 * (arrayTypeCount + 1) > arrayTypeTableSize)
+    growArrayTypes();
+  insertArrayType(arrayTypes, arrayTypeTableSize, type);
+  arrayTypeCount ++;
+}
+
 Type* makeArrayType(int arraySize, Type* elementType) {
-  Type* type = (Type*) malloc(sizeof(Type));
+  Type* type;
+  unsigned int slot;
+
+  if (arrayTypeTableSize > 0) {
+    slot = arrayTypeSlot(arraySize, elementType, arrayTypeTableSize);
+    symtabStats.probes ++;
+    while ((type = arrayTypes[slot]) != NULL) {
+      if (type->arraySize == arraySize && type->elementType == elementType)
+	return type;
+      slot = (slot + 1) & (arrayTypeTableSize - 1);
+      symtabStats.collisions ++;
+    }
+  }
+
+  type = (Type*) symtabAlloc(sizeof(Type), ALLOC_TYPE);
   type->typeClass = TP_ARRAY;
   type->arraySize = arraySize;
   type->elementType = elementType;
-  return type;
-}
 
-Type* duplicateType(Type* type) {
-  Type* resultType = (Type*) malloc(sizeof(Type));
-  resultType->typeClass = type->typeClass;
-  if (type->typeClass == TP_ARRAY) {
-    resultType->arraySize = type->arraySize;
-    resultType->elementType = duplicateType(type->elementType);
-  }
-  return resultType;
+  addArrayType(type);
+  symtabStats.arrayTypes ++;
+  return type;
 }
 
 int compareType(Type* type1, Type* type2) {
-  if (type1->typeClass == type2->typeClass) {
-    if (type1->typeClass == TP_ARRAY) {
-      if (type1->arraySize == type2->arraySize)
-	return compareType(type1->elementType, type2->elementType);
-      else return 0;
-    } else return 1;
-  } else return 0;
-}
-
-void freeType(Type* type) {
-  switch (type->typeClass) {
-  case TP_INT:
-  case TP_CHAR:
-    free(type);
-    break;
-  case TP_ARRAY:
-    freeType(type->elementType);
-    freeType(type);
-    break;
-  }
+  return type1 == type2;
 }
 
 /******************* Constant utility ******************************/
 
 ConstantValue* makeIntConstant(int i) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) symtabAlloc(sizeof(ConstantValue), ALLOC_CONSTANT);
   value->type = TP_INT;
   value->intValue = i;
   return value;
 }
 
 ConstantValue* makeCharConstant(char ch) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) symtabAlloc(sizeof(ConstantValue), ALLOC_CONSTANT);
   value->type = TP_CHAR;
   value->charValue = ch;
   return value;
 }
 
 ConstantValue* duplicateConstantValue(ConstantValue* v) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) symtabAlloc(sizeof(ConstantValue), ALLOC_CONSTANT);
   value->type = v->type;
   if (v->type == TP_INT) 
     value->intValue = v->intValue;
@@ -103,209 +168,303 @@ ConstantValue* duplicateConstantValue(ConstantValue* v) {
 /******************* Object utilities ******************************/
 
 Scope* createScope(Object* owner, Scope* outer) {
-  Scope* scope = (Scope*) malloc(sizeof(Scope));
+  Scope* scope = (Scope*) symtabAlloc(sizeof(Scope), ALLOC_SCOPE);
   scope->objList = NULL;
+  scope->objTail = &(scope->objList);
   scope->owner = owner;
   scope->outer = outer;
+  scope->level = (outer == NULL) ? 0 : outer->level + 1;
+  symtabStats.scopes[STATS_LEVEL(scope->level)] ++;
+  scope->frameSize = 0;
+  scope->objectCount = 0;
+  scope->tableSize = 0;
+  scope->table = NULL;
+  scope->objectBlock = NULL;
+  scope->objectBlockUsed = 0;
+  scope->objectBlockSize = 0;
   return scope;
 }
 
-Object* createProgramObject(char *programName) {
-  Object* program = (Object*) malloc(sizeof(Object));
-  strcpy(program->name, programName);
-  program->kind = OBJ_PROGRAM;
-  program->progAttrs = (ProgramAttributes*) malloc(sizeof(ProgramAttributes));
-  program->progAttrs->scope = createScope(program,NULL);
+/* Objects are made in blocks of the current scope, so that those of a
+   scope lie together; each block of a scope is twice the one before */
+#define FIRST_OBJECT_BLOCK 8
+
+Object* allocObject(void) {
+  Scope* scope = symtab->currentScope;
+
+  if (scope == NULL)
+    return (Object*) symtabAlloc(sizeof(Object), ALLOC_OBJECT);
+
+  if (scope->objectBlockUsed == scope->objectBlockSize) {
+    scope->objectBlockSize = (scope->objectBlockSize == 0) ? FIRST_OBJECT_BLOCK : 2 * scope->objectBlockSize;
+    scope->objectBlock = (Object*) symtabAlloc(scope->objectBlockSize * sizeof(Object), ALLOC_OBJECT);
+    scope->objectBlockUsed = 0;
+  }
+  return &(scope->objectBlock[scope->objectBlockUsed++]);
+}
+
+/* Level and slot are set when the object is declared in a scope */
+Object* makeObject(SymbolId symbol, enum ObjectKind kind) {
+  Object* obj = allocObject();
+  obj->symbol = symbol;
+  obj->kind = kind;
+  obj->level = 0;
+  obj->slot = -1;
+  symtabStats.objects[kind] ++;
+  return obj;
+}
+
+Object* createProgramObject(SymbolId symbol) {
+  Object* program = makeObject(symbol, OBJ_PROGRAM);
+  program->progAttrs.scope = createScope(program, symtab->globalScope);
+  program->progAttrs.isUnit = 0;
   symtab->program = program;
 
   return program;
 }
 
-Object* createConstantObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_CONSTANT;
-  obj->constAttrs = (ConstantAttributes*) malloc(sizeof(ConstantAttributes));
-  return obj;
+Object* createConstantObject(SymbolId symbol) {
+  return makeObject(symbol, OBJ_CONSTANT);
 }
 
-Object* createTypeObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_TYPE;
-  obj->typeAttrs = (TypeAttributes*) malloc(sizeof(TypeAttributes));
-  return obj;
+Object* createTypeObject(SymbolId symbol) {
+  return makeObject(symbol, OBJ_TYPE);
 }
 
-Object* createVariableObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_VARIABLE;
-  obj->varAttrs = (VariableAttributes*) malloc(sizeof(VariableAttributes));
-  obj->varAttrs->scope = symtab->currentScope;
+Object* createVariableObject(SymbolId symbol) {
+  Object* obj = makeObject(symbol, OBJ_VARIABLE);
+  obj->varAttrs.scope = symtab->currentScope;
   return obj;
 }
 
-Object* createFunctionObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_FUNCTION;
-  obj->funcAttrs = (FunctionAttributes*) malloc(sizeof(FunctionAttributes));
-  obj->funcAttrs->paramList = NULL;
-  obj->funcAttrs->scope = createScope(obj, symtab->currentScope);
+Object* createFunctionObject(SymbolId symbol) {
+  Object* obj = makeObject(symbol, OBJ_FUNCTION);
+  obj->funcAttrs.paramList = NULL;
+  obj->funcAttrs.paramTail = &(obj->funcAttrs.paramList);
+  obj->funcAttrs.returnType = NULL;
+  obj->funcAttrs.scope = createScope(obj, symtab->currentScope);
   return obj;
 }
 
-Object* createProcedureObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PROCEDURE;
-  obj->procAttrs = (ProcedureAttributes*) malloc(sizeof(ProcedureAttributes));
-  obj->procAttrs->paramList = NULL;
-  obj->procAttrs->scope = createScope(obj, symtab->currentScope);
+Object* createProcedureObject(SymbolId symbol) {
+  Object* obj = makeObject(symbol, OBJ_PROCEDURE);
+  obj->procAttrs.paramList = NULL;
+  obj->procAttrs.paramTail = &(obj->procAttrs.paramList);
+  obj->procAttrs.scope = createScope(obj, symtab->currentScope);
   return obj;
 }
 
-Object* createParameterObject(char *name, enum ParamKind kind, Object* owner) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
-  obj->kind = OBJ_PARAMETER;
-  obj->paramAttrs = (ParameterAttributes*) malloc(sizeof(ParameterAttributes));
-  obj->paramAttrs->kind = kind;
-  obj->paramAttrs->function = owner;
+Object* createParameterObject(SymbolId symbol, enum ParamKind kind, Object* owner) {
+  Object* obj = makeObject(symbol, OBJ_PARAMETER);
+  obj->paramAttrs.kind = kind;
+  obj->paramAttrs.function = owner;
   return obj;
 }
 
-void freeObject(Object* obj) {
-  switch (obj->kind) {
-  case OBJ_CONSTANT:
-    free(obj->constAttrs->value);
-    free(obj->constAttrs);
-    break;
-  case OBJ_TYPE:
-    free(obj->typeAttrs->actualType);
-    free(obj->typeAttrs);
-    break;
-  case OBJ_VARIABLE:
-    free(obj->varAttrs->type);
-    free(obj->varAttrs);
-    break;
-  case OBJ_FUNCTION:
-    freeReferenceList(obj->funcAttrs->paramList);
-    freeType(obj->funcAttrs->returnType);
-    freeScope(obj->funcAttrs->scope);
-    free(obj->funcAttrs);
-    break;
-  case OBJ_PROCEDURE:
-    freeReferenceList(obj->procAttrs->paramList);
-    freeScope(obj->procAttrs->scope);
-    free(obj->procAttrs);
-    break;
-  case OBJ_PROGRAM:
-    freeScope(obj->progAttrs->scope);
-    free(obj->progAttrs);
-    break;
-  case OBJ_PARAMETER:
-    freeType(obj->paramAttrs->type);
-    free(obj->paramAttrs);
-  }
-  free(obj);
+/* Appends at the tail of a list and moves the tail to the new node */
+void addObject(ObjectNode ***tail, Object* obj) {
+  ObjectNode* node = (ObjectNode*) symtabAlloc(sizeof(ObjectNode), ALLOC_OBJECT_NODE);
+  node->object = obj;
+  node->next = NULL;
+  **tail = node;
+  *tail = &(node->next);
 }
 
-void freeScope(Scope* scope) {
-  freeObjectList(scope->objList);
-  free(scope);
+Object* findObject(ObjectNode *objList, SymbolId symbol) {
+  while (objList != NULL) {
+    if (objList->object->symbol == symbol) 
+      return objList->object;
+    else objList = objList->next;
+  }
+  return NULL;
 }
 
-void freeObjectList(ObjectNode *objList) {
-  ObjectNode* list = objList;
+/* Symbol IDs are consecutive, Fibonacci hashing spreads them */
+#define SCOPE_TABLE_SLOT(symbol, tableSize) (((symbol) * 2654435761u) & ((tableSize) - 1))
 
-  while (list != NULL) {
-    ObjectNode* node = list;
-    list = list->next;
-    freeObject(node->object);
-    free(node);
+/* The slot of symbol in an open addressing table of objects, or the
+   empty slot where it would go */
+Object** findTableSlot(Object** table, int tableSize, SymbolId symbol) {
+  unsigned int slot = SCOPE_TABLE_SLOT(symbol, tableSize);
+
+  symtabStats.probes ++;
+  while (table[slot] != NULL && table[slot]->symbol != symbol) {
+    slot = (slot + 1) & (tableSize - 1);
+    symtabStats.collisions ++;
   }
+  return &table[slot];
+}
+
+/* A copy of table in newSize slots; the old table stays in the arena,
+   at most as large as the new one */
+Object** growTable(Object** table, int tableSize, int newSize) {
+  Object** newTable = (Object**) symtabAlloc(newSize * sizeof(Object*), ALLOC_TABLE);
+  int i;
+
+  memset(newTable, 0, newSize * sizeof(Object*));
+  for (i = 0; i < tableSize; i++)
+    if (table[i] != NULL)
+      *findTableSlot(newTable, newSize, table[i]->symbol) = table[i];
+  return newTable;
 }
 
-void freeReferenceList(ObjectNode *objList) {
-  ObjectNode* list = objList;
+Object* findScopeObject(Scope* scope, SymbolId symbol) {
+  int i;
 
-  while (list != NULL) {
-    ObjectNode* node = list;
-    list = list->next;
-    free(node);
+  if (scope->tableSize == 0) {
+    for (i = 0; i < scope->objectCount; i++)
+      if (scope->inlineObjects[i]->symbol == symbol)
+	return scope->inlineObjects[i];
+    return NULL;
   }
+  return *findTableSlot(scope->table, scope->tableSize, symbol);
 }
 
-void addObject(ObjectNode **objList, Object* obj) {
-  ObjectNode* node = (ObjectNode*) malloc(sizeof(ObjectNode));
-  node->object = obj;
-  node->next = NULL;
-  if ((*objList) == NULL) 
-    *objList = node;
-  else {
-    ObjectNode *n = *objList;
-    while (n->next != NULL) 
-      n = n->next;
-    n->next = node;
+/* Replaces the inline objects with a table, or doubles the table, to
+   keep it at most half full */
+void growScopeTable(Scope* scope) {
+  int i;
+
+  if (scope->tableSize == 0) {
+    scope->tableSize = 4 * SCOPE_INLINE_SIZE;
+    scope->table = growTable(NULL, 0, scope->tableSize);
+    for (i = 0; i < scope->objectCount; i++)
+      *findTableSlot(scope->table, scope->tableSize, scope->inlineObjects[i]->symbol) = scope->inlineObjects[i];
+  } else {
+    scope->table = growTable(scope->table, scope->tableSize, 2 * scope->tableSize);
+    scope->tableSize *= 2;
   }
 }
 
-Object* findObject(ObjectNode *objList, char *name) {
-  while (objList != NULL) {
-    if (strcmp(objList->object->name, name) == 0) 
-      return objList->object;
-    else objList = objList->next;
+int sizeOfType(Type* type) {
+  if (type->typeClass == TP_ARRAY)
+    return type->arraySize * sizeOfType(type->elementType);
+  return 1;
+}
+
+void addScopeObject(Scope* scope, Object* obj) {
+  Object** slot;
+
+  addObject(&(scope->objTail), obj);
+
+  obj->level = scope->level;
+  switch (obj->kind) {
+  case OBJ_VARIABLE:
+    obj->slot = scope->frameSize;
+    scope->frameSize += sizeOfType(obj->varAttrs.type);
+    break;
+  case OBJ_PARAMETER:
+    obj->slot = scope->frameSize++;
+    break;
+  default:
+    break;
   }
-  return NULL;
+
+  if (scope->tableSize == 0 && scope->objectCount < SCOPE_INLINE_SIZE) {
+    scope->inlineObjects[scope->objectCount++] = obj;
+    return;
+  }
+
+  if (scope->tableSize == 0 || 2 * (scope->objectCount + 1) > scope->tableSize)
+    growScopeTable(scope);
+  // like the list, the table keeps the first object of a symbol
+  slot = findTableSlot(scope->table, scope->tableSize, obj->symbol);
+  if (*slot == NULL)
+    *slot = obj;
+  scope->objectCount ++;
 }
 
 /******************* others ******************************/
 
-void initSymTab(void) {
+void declareBuiltins(void) {
   Object* obj;
   Object* param;
 
-  symtab = (SymTab*) malloc(sizeof(SymTab));
-  symtab->globalObjectList = NULL;
-  
-  obj = createFunctionObject("READC");
-  obj->funcAttrs->returnType = makeCharType();
-  addObject(&(symtab->globalObjectList), obj);
+  obj = createFunctionObject(internSymbol("READC"));
+  obj->funcAttrs.returnType = makeCharType();
+  addScopeObject(symtab->globalScope, obj);
+
+  obj = createFunctionObject(internSymbol("READI"));
+  obj->funcAttrs.returnType = makeIntType();
+  addScopeObject(symtab->globalScope, obj);
+
+  obj = createProcedureObject(internSymbol("WRITEI"));
+  param = createParameterObject(internSymbol("i"), PARAM_VALUE, obj);
+  param->paramAttrs.type = makeIntType();
+  addObject(&(obj->procAttrs.paramTail),param);
+  addScopeObject(symtab->globalScope, obj);
+
+  obj = createProcedureObject(internSymbol("WRITEC"));
+  param = createParameterObject(internSymbol("ch"), PARAM_VALUE, obj);
+  param->paramAttrs.type = makeCharType();
+  addObject(&(obj->procAttrs.paramTail),param);
+  addScopeObject(symtab->globalScope, obj);
+
+  obj = createProcedureObject(internSymbol("WRITELN"));
+  addScopeObject(symtab->globalScope, obj);
+}
+
+/* Made by the first compilation of the run. The prelude scope is at
+   level 0 like the global scope; its symbols stay valid since the
+   intern table is only cleaned at the end of the run. */
+void makePrelude(void) {
+  int i;
+
+  makingPrelude = 1;
+  intType = makePrimitiveType(TP_INT);
+  charType = makePrimitiveType(TP_CHAR);
+  if (symbolImageMapped()) {
+    // its objects are made in its blocks
+    preludeScope = createScope(NULL, NULL);
+    symtab->currentScope = preludeScope;
+    declareImageObjects(preludeScope);
+    symtab->currentScope = NULL;
+  }
+  makingPrelude = 0;
 
-  obj = createFunctionObject("READI");
-  obj->funcAttrs->returnType = makeIntType();
-  addObject(&(symtab->globalObjectList), obj);
+  preludeTypes = (Type**) malloc((arrayTypeCount + 1) * sizeof(Type*));
+  for (i = 0; i < arrayTypeTableSize; i++)
+    if (arrayTypes[i] != NULL)
+      preludeTypes[preludeTypeCount++] = arrayTypes[i];
+}
+
+/* The global scope, at level 0, holds the built-in objects, unless a
+   symbol image is mapped: its objects are then in the prelude scope,
+   outer to the global one. Units are imported into the global scope. */
+void initSymTab(void) {
+  int i;
 
-  obj = createProcedureObject("WRITEI");
-  param = createParameterObject("i", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeIntType();
-  addObject(&(obj->procAttrs->paramList),param);
-  addObject(&(symtab->globalObjectList), obj);
+  memset(&symtabStats, 0, sizeof(SymTabStats));
+  symtab = (SymTab*) symtabAlloc(sizeof(SymTab), ALLOC_SYMTAB);
+  symtab->program = NULL;
+  symtab->currentScope = NULL;
 
-  obj = createProcedureObject("WRITEC");
-  param = createParameterObject("ch", PARAM_VALUE, obj);
-  param->paramAttrs->type = makeCharType();
-  addObject(&(obj->procAttrs->paramList),param);
-  addObject(&(symtab->globalObjectList), obj);
+  if (intType == NULL)
+    makePrelude();
+  else
+    for (i = 0; i < preludeTypeCount; i++)
+      addArrayType(preludeTypes[i]);
 
-  obj = createProcedureObject("WRITELN");
-  addObject(&(symtab->globalObjectList), obj);
+  symtab->globalScope = createScope(NULL, NULL);
+  symtab->globalScope->outer = preludeScope;
+  enterBlock(symtab->globalScope);
 
-  intType = makeIntType();
-  charType = makeCharType();
+  if (preludeScope == NULL)
+    declareBuiltins();
 }
 
+/* The prelude and the primitive types are kept for the next one */
 void cleanSymTab(void) {
-  freeObject(symtab->program);
-  freeObjectList(symtab->globalObjectList);
-  free(symtab);
-  freeType(intType);
-  freeType(charType);
+  resetArena(&symtabArena);
+  resetArena(&typeArena);
+  symtab = NULL;
+  arrayTypes = NULL;
+  arrayTypeCount = 0;
+  arrayTypeTableSize = 0;
 }
 
 void enterBlock(Scope* scope) {
+  scope->mark = markArena(&symtabArena);
   symtab->currentScope = scope;
 }
 
@@ -313,22 +472,70 @@ void exitBlock(void) {
   symtab->currentScope = symtab->currentScope->outer;
 }
 
+/* Gives back all made since a subprogram's scope was entered, which
+   must be the last one exited: its objects, the scopes in it and their
+   tables. The owner keeps its header, with the parameters copied to
+   the top of the arena, and is left without a scope. */
+void releaseScope(Scope* scope) {
+  Object* owner = scope->owner;
+  ObjectNode **paramList;
+  ObjectNode ***paramTail;
+  ObjectNode *node;
+  Object *params, *saved;
+  ObjectNode *nodes;
+  int paramCount = 0;
+  int i;
+
+  if (owner->kind == OBJ_FUNCTION) {
+    paramList = &(owner->funcAttrs.paramList);
+    paramTail = &(owner->funcAttrs.paramTail);
+    owner->funcAttrs.scope = NULL;
+  } else {
+    paramList = &(owner->procAttrs.paramList);
+    paramTail = &(owner->procAttrs.paramTail);
+    owner->procAttrs.scope = NULL;
+  }
+
+  for (node = *paramList; node != NULL; node = node->next)
+    paramCount ++;
+  saved = (Object*) malloc((paramCount + 1) * sizeof(Object));
+  for (i = 0, node = *paramList; node != NULL; i++, node = node->next)
+    saved[i] = *(node->object);
+
+  symtabStats.releasedScopes ++;
+  symtabStats.releasedBytes += releaseArena(&symtabArena, scope->mark);
+
+  // the parameters and their list, each in one piece
+  params = (Object*) symtabAlloc(paramCount * sizeof(Object), ALLOC_OBJECT);
+  nodes = (ObjectNode*) symtabAlloc(paramCount * sizeof(ObjectNode), ALLOC_OBJECT_NODE);
+  *paramList = NULL;
+  *paramTail = paramList;
+  for (i = 0; i < paramCount; i++) {
+    params[i] = saved[i];
+    nodes[i].object = &params[i];
+    nodes[i].next = NULL;
+    **paramTail = &nodes[i];
+    *paramTail = &(nodes[i].next);
+  }
+  free(saved);
+}
+
 void declareObject(Object* obj) {
   if (obj->kind == OBJ_PARAMETER) {
     Object* owner = symtab->currentScope->owner;
     switch (owner->kind) {
     case OBJ_FUNCTION:
-      addObject(&(owner->funcAttrs->paramList), obj);
+      addObject(&(owner->funcAttrs.paramTail), obj);
       break;
     case OBJ_PROCEDURE:
-      addObject(&(owner->procAttrs->paramList), obj);
+      addObject(&(owner->procAttrs.paramTail), obj);
       break;
     default:
       break;
     }
   }
  
-  addObject(&(symtab->currentScope->objList), obj);
+  addScopeObject(symtab->currentScope, obj);
 }
 
 
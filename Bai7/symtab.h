@@ -7,6 +7,8 @@
 #ifndef __SYMTAB_H__
 #define __SYMTAB_H__
 
+#include <stddef.h>
+#include "arena.h"
 #include "token.h"
 
 enum TypeClass {
@@ -30,6 +32,7 @@ enum ParamKind {
   PARAM_REFERENCE
 };
 
+/* Types are shared and never changed: equal types are the same object */
 struct Type_ {
   enum TypeClass typeClass;
   int arraySize;
@@ -55,7 +58,7 @@ struct ObjectNode_;
 struct Object_;
 
 struct ConstantAttributes_ {
-  ConstantValue* value;
+  ConstantValue value;
 };
 
 struct VariableAttributes_ {
@@ -67,19 +70,25 @@ struct TypeAttributes_ {
   Type *actualType;
 };
 
+/* A tail is the next field of the last node of a list, or its head
+   while the list is empty */
 struct ProcedureAttributes_ {
   struct ObjectNode_ *paramList;
+  struct ObjectNode_ **paramTail;
   struct Scope_* scope;
 };
 
 struct FunctionAttributes_ {
   struct ObjectNode_ *paramList;
+  struct ObjectNode_ **paramTail;
   Type* returnType;
   struct Scope_ *scope;
 };
 
+/* A unit is compiled for the declarations it exports */
 struct ProgramAttributes_ {
   struct Scope_ *scope;
+  int isUnit;
 };
 
 struct ParameterAttributes_ {
@@ -96,17 +105,23 @@ typedef struct ProcedureAttributes_ ProcedureAttributes;
 typedef struct ProgramAttributes_ ProgramAttributes;
 typedef struct ParameterAttributes_ ParameterAttributes;
 
+/* level is that of the scope declaring the object, 0 for the built-in
+   ones. Variables and parameters have a slot in the frame of that
+   scope; other objects have slot -1. The attributes are kept in the
+   object, the one of its kind is valid */
 struct Object_ {
-  char name[MAX_IDENT_LEN];
+  SymbolId symbol;
   enum ObjectKind kind;
+  int level;
+  int slot;
   union {
-    ConstantAttributes* constAttrs;
-    VariableAttributes* varAttrs;
-    TypeAttributes* typeAttrs;
-    FunctionAttributes* funcAttrs;
-    ProcedureAttributes* procAttrs;
-    ProgramAttributes* progAttrs;
-    ParameterAttributes* paramAttrs;
+    ConstantAttributes constAttrs;
+    VariableAttributes varAttrs;
+    TypeAttributes typeAttrs;
+    FunctionAttributes funcAttrs;
+    ProcedureAttributes procAttrs;
+    ProgramAttributes progAttrs;
+    ParameterAttributes paramAttrs;
   };
 };
 
@@ -119,10 +134,28 @@ struct ObjectNode_ {
 
 typedef struct ObjectNode_ ObjectNode;
 
+/* Objects of a scope are found by symbol through a linear search of
+   inlineObjects while they fit, then through an open addressing table
+   of tableSize slots. objList keeps the declaration order */
+#define SCOPE_INLINE_SIZE 8
+
 struct Scope_ {
   ObjectNode *objList;
+  ObjectNode **objTail;
   Object *owner;
   struct Scope_ *outer;
+  int level;
+  int frameSize;
+  int objectCount;
+  int tableSize;
+  Object **table;
+  Object *inlineObjects[SCOPE_INLINE_SIZE];
+  // where the objects made in the scope are stored
+  Object *objectBlock;
+  int objectBlockUsed;
+  int objectBlockSize;
+  // the top of the arena when the scope was entered
+  ArenaMark mark;
 };
 
 typedef struct Scope_ Scope;
@@ -130,17 +163,55 @@ typedef struct Scope_ Scope;
 struct SymTab_ {
   Object* program;
   Scope* currentScope;
-  ObjectNode *globalObjectList;
+  // the built-in or loaded objects, outer to the program scope
+  Scope* globalScope;
 };
 
 typedef struct SymTab_ SymTab;
 
+/* Counters of the last compilation, levels from STATS_MAX_LEVEL on
+   are counted together */
+#define STATS_MAX_LEVEL 16
+#define STATS_LEVEL(level) ((level) < STATS_MAX_LEVEL ? (level) : STATS_MAX_LEVEL)
+
+enum AllocKind {
+  ALLOC_TYPE,
+  ALLOC_CONSTANT,
+  ALLOC_OBJECT,
+  ALLOC_OBJECT_NODE,
+  ALLOC_SCOPE,
+  ALLOC_TABLE,
+  ALLOC_SYMTAB,
+  NUM_OF_ALLOC_KINDS
+};
+
+struct SymTabStats_ {
+  int objects[OBJ_PROGRAM + 1];
+  int arrayTypes;
+  int scopes[STATS_MAX_LEVEL + 1];
+  // lookups by the level of the scope they start from
+  int lookups[STATS_MAX_LEVEL + 1];
+  // scopes searched by each lookup
+  int chainLengths[STATS_MAX_LEVEL + 1];
+  int failedLookups;
+  // hash table searches and the extra slots they went through
+  long probes;
+  long collisions;
+  long bytes[NUM_OF_ALLOC_KINDS];
+  // given back by releaseScope
+  int releasedScopes;
+  long releasedBytes;
+};
+
+typedef struct SymTabStats_ SymTabStats;
+
+extern SymTabStats symtabStats;
+
 Type* makeIntType(void);
 Type* makeCharType(void);
+void addArrayType(Type* type);
 Type* makeArrayType(int arraySize, Type* elementType);
-Type* duplicateType(Type* type);
 int compareType(Type* type1, Type* type2);
-void freeType(Type* type);
 
 ConstantValue* makeIntConstant(int i);
 ConstantValue* makeCharConstant(char ch);
@@ -148,20 +219,27 @@ ConstantValue* duplicateConstantValue(ConstantValue* v);
 
 Scope* createScope(Object* owner, Scope* outer);
 
-Object* createProgramObject(char *programName);
-Object* createConstantObject(char *name);
-Object* createTypeObject(char *name);
-Object* createVariableObject(char *name);
-Object* createFunctionObject(char *name);
-Object* createProcedureObject(char *name);
-Object* createParameterObject(char *name, enum ParamKind kind, Object* owner);
+Object* createProgramObject(SymbolId symbol);
+Object* createConstantObject(SymbolId symbol);
+Object* createTypeObject(SymbolId symbol);
+Object* createVariableObject(SymbolId symbol);
+Object* createFunctionObject(SymbolId symbol);
+Object* createProcedureObject(SymbolId symbol);
+Object* createParameterObject(SymbolId symbol, enum ParamKind kind, Object* owner);
+
+Object* findObject(ObjectNode *objList, SymbolId symbol);
+Object* findScopeObject(Scope* scope, SymbolId symbol);
+void addScopeObject(Scope* scope, Object* obj);
+int sizeOfType(Type* type);
+void* symtabAlloc(size_t size, enum AllocKind kind);
 
-Object* findObject(ObjectNode *objList, char *name);
+void addObject(ObjectNode ***tail, Object* obj);
 
 void initSymTab(void);
 void cleanSymTab(void);
 void enterBlock(Scope* scope);
 void exitBlock(void);
+void releaseScope(Scope* scope);
 void declareObject(Object* obj);
 
 #endif
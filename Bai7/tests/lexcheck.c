@@ -0,0 +1,102 @@
+/* Token stream checks
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reader.h"
+#include "tokenstream.h"
+#include "parlex.h"
+#include "relex.h"
+
+/* Lexes a file from start to end, then another way, and prints "same"
+   if the two token streams are equal, else the first token where they
+   differ. Both ways intern into the global table, so equal names have
+   equal symbol IDs.
+
+   lexcheck -j N FILE     lexes FILE in parallel on N threads
+   lexcheck -e OFFSET LENGTH TEXT [-e ...] FILE
+                          replaces LENGTH bytes at OFFSET by TEXT, for
+                          each edit in turn, relexing after each one,
+                          and compares with a lexing of the edited
+                          source */
+
+int sameToken(TokenStream *a, TokenStream *b, int i) {
+  return a->tokenTypes[i] == b->tokenTypes[i] && a->starts[i] == b->starts[i] &&
+    a->offsets[i] == b->offsets[i] && a->lengths[i] == b->lengths[i] && a->values[i] == b->values[i];
+}
+
+int compareStreams(TokenStream *expected, TokenStream *actual) {
+  int i;
+
+  for (i = 0; i < expected->count && i < actual->count; i++)
+    if (!sameToken(expected, actual, i)) {
+      printf("token %d at offset %d differs\n", i, expected->offsets[i]);
+      return 1;
+    }
+  if (expected->count != actual->count) {
+    printf("%d tokens instead of %d\n", actual->count, expected->count);
+    return 1;
+  }
+  printf("same\n");
+  return 0;
+}
+
+TokenStream* tokenizeFile(char *fileName, int threadCount) {
+  Reader reader;
+  TokenStream *stream;
+
+  if (openReader(&reader, fileName) == IO_ERROR) {
+    printf("Can\'t read %s!\n", fileName);
+    exit(-1);
+  }
+  if (threadCount > 1)
+    stream = tokenizeParallel(&reader, threadCount);
+  else stream = tokenizeFrom(&reader);
+  closeReader(&reader);
+  return stream;
+}
+
+TokenStream* relexFile(int argc, char *argv[], TokenStream **expected) {
+  Reader reader, edited;
+  TokenStream *stream;
+  int i;
+
+  if (openReader(&reader, argv[argc - 1]) == IO_ERROR) {
+    printf("Can\'t read %s!\n", argv[argc - 1]);
+    exit(-1);
+  }
+  stream = tokenizeFrom(&reader);
+  for (i = 1; i + 3 < argc && strcmp(argv[i], "-e") == 0; i += 4)
+    relexEdit(stream, &reader, atoi(argv[i + 1]), atoi(argv[i + 2]), argv[i + 3], strlen(argv[i + 3]));
+
+  attachReader(&edited, reader.source, reader.sourceLength);
+  *expected = tokenizeFrom(&edited);
+  closeReader(&edited);
+  closeReader(&reader);
+  return stream;
+}
+
+int main(int argc, char *argv[]) {
+  TokenStream *expected, *actual;
+  int result;
+
+  if (argc == 4 && strcmp(argv[1], "-j") == 0) {
+    expected = tokenizeFile(argv[3], 1);
+    actual = tokenizeFile(argv[3], atoi(argv[2]));
+  } else if (argc >= 6 && (argc - 2) % 4 == 0 && strcmp(argv[1], "-e") == 0)
+    actual = relexFile(argc, argv, &expected);
+  else {
+    printf("usage: lexcheck -j N FILE | lexcheck -e OFFSET LENGTH TEXT [-e ...] FILE\n");
+    return -1;
+  }
+
+  result = compareStreams(expected, actual);
+  freeTokenStream(expected);
+  freeTokenStream(actual);
+  return result;
+}
@@ -0,0 +1,259 @@
+#! /bin/bash
+# Runs kplc on small programs written to a temporary directory and
+# checks the lines it prints. Prints FAIL for each mismatch and exits
+# with their count.
+cd "$(dirname "$0")/.."
+(cd tests && make -s) || exit 1
+kplc=$(pwd)/kplc
+lexcheck=$(pwd)/tests/lexcheck
+work=$(mktemp -d)
+trap 'rm -rf $work' EXIT
+failures=0
+
+# expect NAME EXPECTED COMMAND...: the last line printed must be EXPECTED
+expect() {
+  local name=$1 expected=$2
+  shift 2
+  local actual=$("$@" 2>&1 | tail -n 1)
+  if [ "$actual" != "$expected" ]; then
+    echo "FAIL $name: expected '$expected', got '$actual'"
+    failures=$((failures + 1))
+  fi
+}
+
+# An error is reported at a token the scanner has left behind by more
+# than the two buffers of a streamed input
+{
+  printf 'PROGRAM T;\nBEGIN\n  CALL Q (* '
+  for i in $(seq 15000); do printf 'a comment line\n'; done
+  printf ' *) ;\nEND.\n'
+} > $work/comment.kpl
+expect long-comment "3-8:Undeclared procedure." $kplc $work/comment.kpl
+expect long-comment-stdin "3-8:Undeclared procedure." sh -c "$kplc - < $work/comment.kpl"
+
+# A streamed input keeps no table of its lines: 20 million of them fit
+# in 30M of address space
+{
+  printf 'PROGRAM T;\nBEGIN (*'
+  head -c 20000000 /dev/zero | tr '\0' '\n'
+  printf '*) CALL Q END.\n'
+} > $work/lines.kpl
+expect many-lines-stdin "20000002-9:Undeclared procedure." sh -c "ulimit -v 30000; $kplc - < $work/lines.kpl"
+rm $work/lines.kpl
+
+# A streamed input is compiled as far as it has arrived, without
+# waiting for a full buffer
+expect partial-stdin "2-12:Undeclared procedure." sh -c "(printf 'PROGRAM T;\nBEGIN CALL Q END.\n'; sleep 2) | timeout 1 $kplc -"
+
+# number NAME LITERAL EXPECTED: the value of a constant, read eight
+# digits at a time while they last
+number() {
+  printf "PROGRAM T;\nCONST N = $2;\nBEGIN END.\n" > $work/number.kpl
+  expect number-$1 "$3" $kplc $work/number.kpl
+}
+number 1-digit 7 "    Const N = 7"
+number 7-digits 1234567 "    Const N = 1234567"
+number 8-digits 12345678 "    Const N = 12345678"
+number 9-digits 123456789 "    Const N = 123456789"
+number 16-digits 0000001234567890 "    Const N = 1234567890"
+number 16-digits-too-large 1000000000000000 "2-11:Number too large."
+number int-max 2147483647 "    Const N = 2147483647"
+number int-max-plus-one 2147483648 "2-11:Number too large."
+number 16-digits-int-max 0000002147483647 "    Const N = 2147483647"
+number 16-digits-int-max-plus-one 0000002147483648 "2-11:Number too large."
+# across the end of the first 64K buffer of a streamed input
+{
+  printf 'PROGRAM T;\n(*'
+  head -c 65507 /dev/zero | tr '\0' 'x'
+  printf '*)\nCONST N = 2147483647;\nBEGIN END.\n'
+} > $work/number.kpl
+expect number-across-buffers "    Const N = 2147483647" sh -c "$kplc - < $work/number.kpl"
+
+# Streaming prints no subprogram after an error was collected
+printf 'PROGRAM T;\nVAR x : INTEGER;\nPROCEDURE P;\nBEGIN x := y END;\nPROCEDURE Q;\nBEGIN x := 1 END;\nBEGIN END.\n' > $work/stream.kpl
+expect stream-after-error 0 sh -c "$kplc --stream --max-errors 5 $work/stream.kpl | grep -c 'Procedure Q'"
+
+# An error in a subprogram header is recovered from within the
+# subprogram: the error in the main program is still reported
+header() {
+  printf 'PROGRAM T;\nVAR x : INTEGER;\n%s\nBEGIN x := 1 END;\nBEGIN y := 2 END.\n' "$2" > $work/header.kpl
+  expect header-$1 "5-7:Undeclared identifier." $kplc --max-errors 5 $work/header.kpl
+}
+header missing-colon 'FUNCTION F(a : INTEGER) INTEGER;'
+header missing-type 'FUNCTION F(a : INTEGER) : ;'
+header missing-semicolon 'FUNCTION F : INTEGER'
+header bad-parameter 'PROCEDURE P(a : INTEGER; 1);'
+header unclosed-parameters 'PROCEDURE P(a : INTEGER;'
+header duplicate 'PROCEDURE x;'
+printf 'PROGRAM T;\nFUNCTION F : CHAR\nVAR a : INTEGER;\nPROCEDURE Q(VAR b : ; c : INTEGER);\nBEGIN b := c END;\nBEGIN a := 1 END;\nBEGIN y := 2 END.\n' > $work/header.kpl
+expect header-nested "7-7:Undeclared identifier." $kplc --max-errors 5 $work/header.kpl
+
+# Statistics from level 16 on, and lookup chains from 16 scopes on,
+# are counted in one entry; here from 20 nested procedures
+{
+  printf 'PROGRAM T;\nVAR x : INTEGER;\n'
+  for i in $(seq 20); do printf 'PROCEDURE P%d;\n' $i; done
+  for i in $(seq 20); do printf 'BEGIN x := %d END;\n' $i; done
+  printf 'BEGIN x := 0 END.\n'
+} > $work/deep.kpl
+expect stats-scopes "Scopes by level: 0:1 1:6 2:1 3:1 4:1 5:1 6:1 7:1 8:1 9:1 10:1 11:1 12:1 13:1 14:1 15:1 16+:6" \
+  sh -c "$kplc --stats $work/deep.kpl | grep 'Scopes by level'"
+expect stats-chains "Lookup chain lengths: 1:1 2:1 3:1 4:1 5:1 6:1 7:1 8:1 9:1 10:1 11:1 12:1 13:1 14:1 15:1 16+:6" \
+  sh -c "$kplc --stats $work/deep.kpl | grep 'Lookup chain lengths'"
+
+# The JSON diagnostics of tests/diagnostics.kpl match
+# tests/diagnostics.json, for a source named with a '"' and a '\'
+cp tests/diagnostics.kpl "$work/a\"b\\c.kpl"
+for mode in "" --pretokenize "--lex-threads 4"; do
+  rm -f $work/diagnostics.json
+  (cd $work && $kplc --max-errors 10 --diagnostics-json diagnostics.json $mode 'a"b\c.kpl' > /dev/null)
+  if ! cmp -s $work/diagnostics.json tests/diagnostics.json; then
+    echo "FAIL diagnostics-json $mode:"
+    diff $work/diagnostics.json tests/diagnostics.json
+    failures=$((failures + 1))
+  fi
+done
+
+# Lexing in parallel gives the tokens of a sequential scan when the
+# chunks are cut inside a comment, a char constant, a number or '<='.
+# The sources are over 256K so that 4 threads make 4 chunks. Each
+# comment ends with '(*)', which a scan started inside it as code takes
+# for the start of another comment, so there only the run that assumes
+# an open comment lines up.
+{
+  printf 'PROGRAM T;\nBEGIN\n'
+  for i in $(seq 450); do
+    printf 'x := 1;\n(*'
+    for j in $(seq 20); do printf "a comment with 'q' and * ) (. x := '*' *\n"; done
+    printf '(*)\n'
+  done
+  printf 'y := 2 END.\n'
+} > $work/comment-chunks.kpl
+{
+  printf 'PROGRAM T;\nBEGIN\n'
+  for i in $(seq 13000); do printf "c:='(';d:='*';e:=')'\n"; done
+  printf 'END.\n'
+} > $work/char-chunks.kpl
+{
+  printf 'PROGRAM T;\nBEGIN\n'
+  for i in $(seq 9000); do printf 'ABCDEFGHIJKLM:=1234567890+X(*c*)<=Y\n'; done
+  printf 'END.\n'
+} > $work/token-chunks.kpl
+for f in comment-chunks char-chunks token-chunks; do
+  for n in 2 3 4; do
+    expect parallel-$f-$n same $lexcheck -j $n $work/$f.kpl
+  done
+done
+
+# Relexing after an edit gives the tokens of a lexing of the edited
+# source. at TEXT is the offset of the first TEXT in relex.kpl.
+printf "PROGRAM T;\nVAR x : INTEGER; (* note *)\nBEGIN\n  x := 12 + 3; (* a 'c' *) x := 'a'\nEND.\n" > $work/relex.kpl
+at() {
+  local source=$(cat $work/relex.kpl)
+  local before=${source%%"$1"*}
+  echo ${#before}
+}
+relex() {
+  local name=$1
+  shift
+  expect relex-$name same $lexcheck "$@" $work/relex.kpl
+}
+relex insert-in-ident -e $(($(at 'x :=') + 1)) 0 YZ
+relex insert-in-number -e $(($(at 12) + 1)) 0 9
+relex insert-token -e $(at BEGIN) 0 'VAR y : CHAR; '
+relex delete-tokens -e $(at ' + 3') 4 ''
+relex insert-at-start -e 0 0 '(* head *) '
+relex append -e $(at 'END.') 4 'END.  x'
+relex open-comment -e $(at BEGIN) 0 '(* '
+relex delete-comment-start -e $(at '(* note') 2 ''
+relex delete-comment-end -e $(at '*)') 2 ''
+relex span-comment-end -e $(at 'note *)') 13 'BEGIN'
+relex span-comment-start -e $(at '3; (* a') 6 '4 *'
+relex open-char -e $(at '12') 0 "'"
+relex close-char -e $(at "'a'") 1 ''
+relex comment-in-char -e $(($(at "'a'") + 1)) 1 '(*'
+relex several -e 0 0 'X' -e $(($(at BEGIN) + 1)) 0 '(*' -e $(($(at 'x :=') + 3)) 0 '*)'
+
+# A token cache hit gives the output of a compilation without the cache
+# and leaves the cache file as it is
+printf 'PROGRAM T;\nCONST C = 5;\nVAR x : INTEGER;\nBEGIN x := C END.\n' > $work/cache.kpl
+$kplc $work/cache.kpl > $work/cache.out
+$kplc --token-cache $work/cache.kpl > /dev/null
+cp $work/cache.kpl.tkc $work/cache.tkc
+inode=$(stat -c %i $work/cache.kpl.tkc)
+expect cache-hit same sh -c "$kplc --token-cache $work/cache.kpl | cmp -s - $work/cache.out && echo same"
+expect cache-hit-kept $inode stat -c %i $work/cache.kpl.tkc
+
+# rejected NAME OFFSET BYTES: once BYTES are written at OFFSET of the
+# cache file, the source is lexed again and the cache written anew
+rejected() {
+  cp $work/cache.tkc $work/cache.kpl.tkc
+  printf "$3" | dd of=$work/cache.kpl.tkc bs=1 seek=$2 conv=notrunc 2>/dev/null
+  expect $1 same sh -c "$kplc --token-cache $work/cache.kpl | cmp -s - $work/cache.out && cmp -s $work/cache.kpl.tkc $work/cache.tkc && echo same"
+}
+# the header: magic, version, source hash, source length, token count,
+# newline count, name count and names size, 40 bytes with padding
+tokens=$(od -An -t d4 -j 20 -N 4 $work/cache.tkc)
+rejected cache-magic 0 'X'
+rejected cache-version 4 '\003'
+rejected cache-source-length 16 '\377'
+rejected cache-token-count 20 '\377'
+rejected cache-newline-count 24 '\377'
+# the value of token 1, the program name, is past the name count
+rejected cache-name-index $((40 + 12 * tokens + 4)) '\377\377\377\177'
+cp $work/cache.tkc $work/cache.kpl.tkc
+truncate -s 100 $work/cache.kpl.tkc
+expect cache-truncated same sh -c "$kplc --token-cache $work/cache.kpl | cmp -s - $work/cache.out && cmp -s $work/cache.kpl.tkc $work/cache.tkc && echo same"
+
+# An edit that keeps the length of the source changes its hash
+sed -i 's/C = 5/C = 6/' $work/cache.kpl
+$kplc $work/cache.kpl > $work/cache.out
+expect cache-stale same sh -c "$kplc --token-cache $work/cache.kpl | cmp -s - $work/cache.out && echo same"
+expect cache-stale-written 1 sh -c "cmp -s $work/cache.kpl.tkc $work/cache.tkc; echo \$?"
+
+# A unit compiled for the second of two imports does not take the
+# first one as its own import
+mkdir $work/units
+printf 'UNIT ALPHA;\nCONST AN = 1;\nBEGIN END.\n' > $work/units/alpha.kpl
+printf 'UNIT BETA;\nCONST BN = 2;\nBEGIN END.\n' > $work/units/beta.kpl
+printf 'PROGRAM MAIN;\nIMPORT ALPHA, BETA;\nVAR x : INTEGER;\nBEGIN x := AN + BN END.\n' > $work/units/main.kpl
+expect two-imports "    Var X : Int" $kplc $work/units/main.kpl
+expect two-imports-interface 0 grep -c ALPHA $work/units/beta.kpl.kpi
+
+# The objects of a symbol image, made once per run, have the types the
+# program makes for itself, also in the units it imports
+mkdir $work/prelude
+printf 'PROGRAM P;\nCONST N = 10;\nTYPE V = ARRAY(. 10 .) OF INTEGER;\nFUNCTION F(n : INTEGER) : INTEGER;\nBEGIN F := n END;\nBEGIN END.\n' > $work/prelude/p.kpl
+printf 'UNIT U;\nTYPE W = ARRAY(. 10 .) OF INTEGER;\nBEGIN END.\n' > $work/prelude/u.kpl
+printf 'PROGRAM M;\nIMPORT U;\nVAR a : V; b : ARRAY(. 10 .) OF INTEGER; w : W;\nBEGIN a := b; w := a; a(. 1 .) := F(N) END.\n' > $work/prelude/m.kpl
+$kplc --save-symbol-image $work/prelude/p.kpi $work/prelude/p.kpl > /dev/null
+expect prelude-types "    Var W : Arr(10,Int)" $kplc --symbol-image $work/prelude/p.kpi $work/prelude/m.kpl
+printf 'UNIT D;\nCONST N = 3;\nBEGIN END.\n' > $work/prelude/d.kpl
+printf 'PROGRAM Q;\nIMPORT D;\nBEGIN END.\n' > $work/prelude/q.kpl
+expect prelude-clash "2-8:Duplicate identifier." $kplc --symbol-image $work/prelude/p.kpi $work/prelude/q.kpl
+
+# A unit interface compiled under one symbol image is out of date
+# under another: here the unit uses a constant only the first one has
+printf 'PROGRAM P;\nCONST K = 10;\nBEGIN END.\n' > $work/prelude/p2.kpl
+$kplc --save-symbol-image $work/prelude/p2.kpi $work/prelude/p2.kpl > /dev/null
+printf 'UNIT G;\nCONST M = N;\nBEGIN END.\n' > $work/prelude/g.kpl
+printf 'PROGRAM R;\nIMPORT G;\nVAR x : INTEGER;\nBEGIN x := M END.\n' > $work/prelude/r.kpl
+expect prelude-unit "    Var X : Int" $kplc --symbol-image $work/prelude/p.kpi $work/prelude/r.kpl
+expect prelude-changed "2-8:The unit can't be compiled." $kplc --symbol-image $work/prelude/p2.kpi $work/prelude/r.kpl
+
+# Each unit of a chain of diamonds is checked once, not once per path:
+# checking the 3^12 paths to D0 one by one takes about half a minute
+mkdir $work/diamonds
+printf 'UNIT D0;\nCONST C0 = 0;\nBEGIN END.\n' > $work/diamonds/d0.kpl
+for i in $(seq 1 12); do
+  for w in a b c; do
+    printf "UNIT $w$i;\nIMPORT D$((i - 1));\nCONST C$w$i = 1;\nBEGIN END.\n" > $work/diamonds/$w$i.kpl
+  done
+  printf "UNIT D$i;\nIMPORT A$i, B$i, C$i;\nCONST C$i = 1;\nBEGIN END.\n" > $work/diamonds/d$i.kpl
+done
+printf 'PROGRAM MAIN;\nIMPORT D12;\nVAR x : INTEGER;\nBEGIN x := C12 END.\n' > $work/diamonds/main.kpl
+expect diamonds-compiled "    Var X : Int" timeout 10 $kplc $work/diamonds/main.kpl
+expect diamonds-checked "    Var X : Int" timeout 10 $kplc $work/diamonds/main.kpl
+
+echo "$failures failure(s)"
+exit $failures
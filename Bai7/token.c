@@ -31,7 +31,9 @@ struct {
   {"WHILE", KW_WHILE},
   {"DO", KW_DO},
   {"FOR", KW_FOR},
-  {"TO", KW_TO}
+  {"TO", KW_TO},
+  {"UNIT", KW_UNIT},
+  {"IMPORT", KW_IMPORT}
 };
 
 int keywordEq(char *kw, char *string) {
@@ -50,11 +52,12 @@ TokenType checkKeyword(char *string) {
   return TK_NONE;
 }
 
-Token* makeToken(TokenType tokenType, int lineNo, int colNo) {
+Token* makeToken(TokenType tokenType, int offset) {
   Token *token = (Token*)malloc(sizeof(Token));
   token->tokenType = tokenType;
-  token->lineNo = lineNo;
-  token->colNo = colNo;
+  token->offset = offset;
+  token->lineNo = 0;
+  token->colNo = 0;
   return token;
 }
 
@@ -86,6 +89,8 @@ char *tokenToString(TokenType tokenType) {
   case KW_DO: return "keyword DO";
   case KW_FOR: return "keyword FOR";
   case KW_TO: return "keyword TO";
+  case KW_UNIT: return "keyword UNIT";
+  case KW_IMPORT: return "keyword IMPORT";
 
   case SB_SEMICOLON: return "\';\'";
   case SB_COLON: return "\':\'";
@@ -7,8 +7,10 @@
 #ifndef __TOKEN_H__
 #define __TOKEN_H__
 
+#include "intern.h"
+
 #define MAX_IDENT_LEN 15
-#define KEYWORDS_COUNT 20
+#define KEYWORDS_COUNT 22
 
 typedef enum {
   TK_NONE, TK_IDENT, TK_NUMBER, TK_CHAR, TK_EOF,
@@ -19,6 +21,7 @@ typedef enum {
   KW_BEGIN, KW_END, KW_CALL,
   KW_IF, KW_THEN, KW_ELSE,
   KW_WHILE, KW_DO, KW_FOR, KW_TO,
+  KW_UNIT, KW_IMPORT,
 
   SB_SEMICOLON, SB_COLON, SB_PERIOD, SB_COMMA,
   SB_ASSIGN, SB_EQ, SB_NEQ, SB_LT, SB_LE, SB_GT, SB_GE,
@@ -26,15 +29,20 @@ typedef enum {
   SB_LPAR, SB_RPAR, SB_LSEL, SB_RSEL
 } TokenType; 
 
+/* lineNo and colNo are 0 unless the token was read from a streamed
+   input, whose positions can't be found from the offset later */
 typedef struct {
   char string[MAX_IDENT_LEN + 1];
-  int lineNo, colNo;
+  int offset;
+  int lineNo;
+  int colNo;
   TokenType tokenType;
   int value;
+  SymbolId symbol;
 } Token;
 
 TokenType checkKeyword(char *string);
-Token* makeToken(TokenType tokenType, int lineNo, int colNo);
+Token* makeToken(TokenType tokenType, int offset);
 char *tokenToString(TokenType tokenType);
 
 
@@ -0,0 +1,263 @@
+/* Token cache
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "token.h"
+#include "tokencache.h"
+
+#define CACHE_MAGIC "KPLT"
+#define CACHE_VERSION 4
+#define CACHE_SUFFIX ".tkc"
+
+/* Layout of a cache file: the header, then starts, offsets, lengths,
+   values (tokenCount ints each), the newline offsets of the source
+   (newlineCount ints), the token types (tokenCount bytes) and the
+   identifier names, each ending with '\0'. An identifier's value is
+   the 1-based index of its name in the file, symbol IDs being only
+   valid inside one run. */
+typedef struct {
+  char magic[4];
+  int version;
+  unsigned long long sourceHash;
+  int sourceLength;
+  int tokenCount;
+  int newlineCount;
+  int nameCount;
+  int namesSize;
+} CacheHeader;
+
+/* 64-bit FNV-1a */
+unsigned long long hashSource(unsigned char *source, int length) {
+  unsigned long long h = 14695981039346656037ULL;
+  int i;
+
+  for (i = 0; i < length; i++) {
+    h ^= source[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+char* cacheFileName(char *fileName) {
+  char *name = (char*) malloc(strlen(fileName) + strlen(CACHE_SUFFIX) + 5);
+  sprintf(name, "%s%s", fileName, CACHE_SUFFIX);
+  return name;
+}
+
+/* Hashes a file without reading it into a Reader */
+int hashFile(char *fileName, unsigned long long *hash, int *length) {
+  struct stat st;
+  void *data;
+  int fd = open(fileName, O_RDONLY);
+
+  if (fd < 0)
+    return 0;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return 0;
+  }
+
+  *length = (int) st.st_size;
+  if (*length == 0) {
+    *hash = hashSource(NULL, 0);
+    close(fd);
+    return 1;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return 0;
+  *hash = hashSource((unsigned char*) data, *length);
+  munmap(data, st.st_size);
+  return 1;
+}
+
+/* Maps fileName.tkc if it was made from the current contents of
+   fileName. The reader gets the newline table, which is all error
+   reporting needs; it has no source to read. Returns NULL on a miss. */
+TokenStream* loadTokenCache(char *fileName, Reader *reader) {
+  char *cacheName = cacheFileName(fileName);
+  unsigned long long hash;
+  int length;
+  struct stat st;
+  CacheHeader *header;
+  char *data;
+  char *names;
+  SymbolId *symbols;
+  TokenStream *stream;
+  int fd, i, count;
+
+  if (!hashFile(fileName, &hash, &length)) {
+    free(cacheName);
+    return NULL;
+  }
+
+  fd = open(cacheName, O_RDONLY);
+  free(cacheName);
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) < 0 || st.st_size < sizeof(CacheHeader)) {
+    close(fd);
+    return NULL;
+  }
+  // private and writable so identifier values can be rewritten in place
+  data = (char*) mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return NULL;
+
+  header = (CacheHeader*) data;
+  count = header->tokenCount;
+  if (memcmp(header->magic, CACHE_MAGIC, 4) != 0 ||
+      header->version != CACHE_VERSION ||
+      header->sourceHash != hash ||
+      header->sourceLength != length ||
+      count <= 0 || header->newlineCount < 0 || header->nameCount < 0 || header->namesSize < 0 ||
+      (header->namesSize > 0 && data[st.st_size - 1] != '\0') ||
+      st.st_size != sizeof(CacheHeader) + (4 * (long long) count + header->newlineCount) * sizeof(int)
+                    + count + header->namesSize) {
+    munmap(data, st.st_size);
+    return NULL;
+  }
+
+  stream = (TokenStream*) calloc(1, sizeof(TokenStream));
+  stream->starts = (int*) (data + sizeof(CacheHeader));
+  stream->offsets = stream->starts + count;
+  stream->lengths = stream->offsets + count;
+  stream->values = stream->lengths + count;
+  stream->tokenTypes = (unsigned char*) (stream->values + count + header->newlineCount);
+  stream->count = count;
+  stream->capacity = count;
+  stream->mapping = data;
+  stream->mappingSize = st.st_size;
+
+  names = (char*) stream->tokenTypes + count;
+  symbols = (SymbolId*) malloc((header->nameCount + 1) * sizeof(SymbolId));
+  for (i = 1; i <= header->nameCount && names < data + st.st_size; i++) {
+    if ((symbols[i] = internSymbol(names)) == SYMBOL_NONE)
+      break;
+    names += strlen(names) + 1;
+  }
+  if (i <= header->nameCount)
+    count = 0;
+  for (i = 0; i < count; i++)
+    if (stream->tokenTypes[i] == TK_IDENT) {
+      if (stream->values[i] < 1 || stream->values[i] > header->nameCount)
+	break;
+      stream->values[i] = symbols[stream->values[i]];
+    }
+  free(symbols);
+  if (i < stream->count) {
+    freeTokenStream(stream);
+    return NULL;
+  }
+
+  reader->source = NULL;
+  reader->sourceBase = 0;
+  reader->sourceLength = length;
+  reader->ownsSource = 0;
+  reader->input = NULL;
+  reader->charNo = length;
+  reader->currentChar = EOF;
+  reader->newlineCount = header->newlineCount;
+  reader->newlineCapacity = header->newlineCount + 1;
+  reader->newlines = (int*) malloc((header->newlineCount + 1) * sizeof(int));
+  memcpy(reader->newlines, stream->values + count, header->newlineCount * sizeof(int));
+
+  return stream;
+}
+
+/* Writes the cache for a stream just lexed from reader. The file is
+   written under another name and renamed, so a concurrent run never
+   maps half a cache. */
+int saveTokenCache(char *fileName, TokenStream *stream, Reader *reader) {
+  char *cacheName = cacheFileName(fileName);
+  char *tempName = (char*) malloc(strlen(cacheName) + 32);
+  CacheHeader header;
+  int *localIds = NULL;
+  int localCapacity = 0;
+  int *values;
+  FILE *f;
+  int i, ok;
+
+  // only whole sources in memory can be hashed
+  if (reader->input != NULL) {
+    free(tempName);
+    free(cacheName);
+    return 0;
+  }
+  if (reader->newlineCount < 0)
+    buildNewlineTable(reader);
+
+  memset(&header, 0, sizeof(CacheHeader));
+  memcpy(header.magic, CACHE_MAGIC, 4);
+  header.version = CACHE_VERSION;
+  header.sourceHash = hashSource((unsigned char*) reader->source, reader->sourceLength);
+  header.sourceLength = reader->sourceLength;
+  header.tokenCount = stream->count;
+  header.newlineCount = reader->newlineCount;
+
+  // number the identifiers in order of first use
+  values = (int*) malloc(stream->count * sizeof(int));
+  for (i = 0; i < stream->count; i++) {
+    int symbol = stream->values[i];
+
+    values[i] = symbol;
+    if (stream->tokenTypes[i] != TK_IDENT)
+      continue;
+    if (symbol >= localCapacity) {
+      int capacity = (symbol + 1) * 2;
+      localIds = (int*) realloc(localIds, capacity * sizeof(int));
+      memset(localIds + localCapacity, 0, (capacity - localCapacity) * sizeof(int));
+      localCapacity = capacity;
+    }
+    if (localIds[symbol] == 0) {
+      localIds[symbol] = ++ header.nameCount;
+      header.namesSize += strlen(symbolName(symbol)) + 1;
+    }
+    values[i] = localIds[symbol];
+  }
+
+  sprintf(tempName, "%s.%d", cacheName, (int) getpid());
+  f = fopen(tempName, "wb");
+  ok = (f != NULL);
+  if (ok) {
+    fwrite(&header, sizeof(CacheHeader), 1, f);
+    fwrite(stream->starts, sizeof(int), stream->count, f);
+    fwrite(stream->offsets, sizeof(int), stream->count, f);
+    fwrite(stream->lengths, sizeof(int), stream->count, f);
+    fwrite(values, sizeof(int), stream->count, f);
+    fwrite(reader->newlines, sizeof(int), reader->newlineCount, f);
+    fwrite(stream->tokenTypes, 1, stream->count, f);
+    for (i = 0; i < stream->count; i++)
+      if (stream->tokenTypes[i] == TK_IDENT && localIds[stream->values[i]] > 0) {
+	char *name = symbolName(stream->values[i]);
+	fwrite(name, 1, strlen(name) + 1, f);
+	// written once, at its first use
+	localIds[stream->values[i]] = - localIds[stream->values[i]];
+      }
+    ok = !ferror(f);
+    ok = (fclose(f) == 0) && ok;
+    if (ok)
+      ok = (rename(tempName, cacheName) == 0);
+    if (!ok)
+      remove(tempName);
+  }
+
+  free(values);
+  free(localIds);
+  free(tempName);
+  free(cacheName);
+  return ok;
+}
@@ -0,0 +1,22 @@
+/* Token cache
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __TOKENCACHE_H__
+#define __TOKENCACHE_H__
+
+#include "reader.h"
+#include "tokenstream.h"
+
+/* The token stream of a source file can be saved next to it, in
+   fileName.tkc, and mapped back on later runs while the source bytes
+   are unchanged */
+TokenStream* loadTokenCache(char *fileName, Reader *reader);
+int saveTokenCache(char *fileName, TokenStream *stream, Reader *reader);
+
+unsigned long long hashSource(unsigned char *source, int length);
+int hashFile(char *fileName, unsigned long long *hash, int *length);
+
+#endif
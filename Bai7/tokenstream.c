@@ -0,0 +1,97 @@
+/* Token stream
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "scanner.h"
+#include "tokenstream.h"
+
+#define INITIAL_CAPACITY 1024
+
+extern Reader inputReader;
+
+void growTokenStream(TokenStream *stream) {
+  int capacity = (stream->capacity == 0) ? INITIAL_CAPACITY : stream->capacity * 2;
+
+  stream->tokenTypes = (unsigned char*) realloc(stream->tokenTypes, capacity * sizeof(unsigned char));
+  stream->starts = (int*) realloc(stream->starts, capacity * sizeof(int));
+  stream->offsets = (int*) realloc(stream->offsets, capacity * sizeof(int));
+  stream->lengths = (int*) realloc(stream->lengths, capacity * sizeof(int));
+  stream->values = (int*) realloc(stream->values, capacity * sizeof(int));
+  stream->capacity = capacity;
+}
+
+void appendToken(TokenStream *stream, Token *token, int start, int end) {
+  int i = stream->count;
+
+  if (i == stream->capacity)
+    growTokenStream(stream);
+
+  stream->tokenTypes[i] = (unsigned char) token->tokenType;
+  stream->starts[i] = start;
+  stream->offsets[i] = token->offset;
+  stream->lengths[i] = (token->tokenType == TK_EOF) ? 0 : end - token->offset;
+
+  switch (token->tokenType) {
+  case TK_NUMBER: stream->values[i] = token->value; break;
+  case TK_CHAR: stream->values[i] = (unsigned char) token->string[0]; break;
+  case TK_IDENT: stream->values[i] = token->symbol; break;
+  case TK_NONE: stream->values[i] = token->value; break;
+  default: stream->values[i] = 0; break;
+  }
+  stream->count ++;
+}
+
+/* Lexes a source to the end. Invalid tokens are kept in the stream and
+   reported by whoever consumes them, so errors surface in source order. */
+TokenStream* tokenizeFrom(Reader *reader) {
+  TokenStream *stream = (TokenStream*) calloc(1, sizeof(TokenStream));
+  Token *token;
+  int start;
+
+  do {
+    start = reader->charNo;
+    token = getTokenFrom(reader);
+    appendToken(stream, token, start, reader->charNo);
+    free(token);
+  } while (stream->tokenTypes[stream->count - 1] != TK_EOF);
+
+  return stream;
+}
+
+TokenStream* tokenizeInput(void) {
+  return tokenizeFrom(&inputReader);
+}
+
+void freeTokenStream(TokenStream *stream) {
+  if (stream->mapping != NULL)
+    munmap(stream->mapping, stream->mappingSize);
+  else {
+    free(stream->tokenTypes);
+    free(stream->starts);
+    free(stream->offsets);
+    free(stream->lengths);
+    free(stream->values);
+  }
+  free(stream);
+}
+
+/* Fills token from entry index, for code that works on Token*. Only
+   a character is copied to the string; the name of an identifier is
+   symbolName(token->symbol). */
+void readStreamToken(TokenStream *stream, int index, Token *token) {
+  token->tokenType = (TokenType) stream->tokenTypes[index];
+  token->offset = stream->offsets[index];
+  token->lineNo = 0;
+  token->colNo = 0;
+  token->value = stream->values[index];
+  token->symbol = (token->tokenType == TK_IDENT) ? token->value : 0;
+  token->string[0] = (token->tokenType == TK_CHAR) ? (char) token->value : '\0';
+  token->string[1] = '\0';
+}
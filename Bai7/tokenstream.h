@@ -0,0 +1,42 @@
+/* Token stream
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __TOKENSTREAM_H__
+#define __TOKENSTREAM_H__
+
+#include <stddef.h>
+
+#include "token.h"
+#include "reader.h"
+
+/* A whole source file tokenized up front, one array per field.
+   Positions are byte offsets, see getPosition for lines and columns.
+   value holds the number of TK_NUMBER, the character of TK_CHAR, the
+   symbol ID of TK_IDENT and the ErrorCode of an invalid TK_NONE token.
+   starts[i] is where the scanner stood before reading token i, in front
+   of the blanks and comments preceding it. The scanner is never inside
+   a comment there, so lexing can restart at any start. */
+typedef struct {
+  unsigned char *tokenTypes;
+  int *starts;
+  int *offsets;
+  int *lengths;
+  int *values;
+  int count;
+  int capacity;
+  // set when the arrays live in a mapped cache file
+  void *mapping;
+  size_t mappingSize;
+} TokenStream;
+
+void growTokenStream(TokenStream *stream);
+void appendToken(TokenStream *stream, Token *token, int start, int end);
+TokenStream* tokenizeFrom(Reader *reader);
+TokenStream* tokenizeInput(void);
+void freeTokenStream(TokenStream *stream);
+void readStreamToken(TokenStream *stream, int index, Token *token);
+
+#endif
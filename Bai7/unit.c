@@ -0,0 +1,267 @@
+/* Units
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "parser.h"
+#include "symtab.h"
+#include "symimage.h"
+#include "tokencache.h"
+#include "unit.h"
+
+#define INTERFACE_SUFFIX ".kpi"
+#define MAX_UNIT_NESTING 32
+
+extern SymTab* symtab;
+
+/* The units imported by the current compilation and their keys, in
+   order of import */
+char **importNames = NULL;
+unsigned long long *importKeys = NULL;
+int importCount = 0;
+int importCapacity = 0;
+
+/* The units being compiled, by this process or by those that started
+   it, so that cyclic imports end */
+char *unitChain[MAX_UNIT_NESTING];
+int unitChainLength = 0;
+
+/* Units whose interface was found up to date in this run, with its
+   key; sources are taken not to change during a run. Without it, a
+   unit imported along several paths would be checked once per path. */
+char **verifiedUnits = NULL;
+unsigned long long *verifiedKeys = NULL;
+int verifiedCount = 0;
+int verifiedCapacity = 0;
+
+int findVerified(char *unitFile) {
+  int i;
+
+  for (i = 0; i < verifiedCount; i++)
+    if (strcmp(verifiedUnits[i], unitFile) == 0)
+      return i;
+  return -1;
+}
+
+void rememberVerified(char *unitFile, unsigned long long key) {
+  int i = findVerified(unitFile);
+
+  if (i >= 0) {
+    verifiedKeys[i] = key;
+    return;
+  }
+  if (verifiedCount == verifiedCapacity) {
+    verifiedCapacity = (verifiedCapacity == 0) ? 8 : 2 * verifiedCapacity;
+    verifiedUnits = (char**) realloc(verifiedUnits, verifiedCapacity * sizeof(char*));
+    verifiedKeys = (unsigned long long*) realloc(verifiedKeys, verifiedCapacity * sizeof(unsigned long long));
+  }
+  verifiedUnits[verifiedCount] = (char*) malloc(strlen(unitFile) + 1);
+  strcpy(verifiedUnits[verifiedCount], unitFile);
+  verifiedKeys[verifiedCount] = key;
+  verifiedCount ++;
+}
+
+char* interfaceFileName(char *fileName) {
+  char *name = (char*) malloc(strlen(fileName) + strlen(INTERFACE_SUFFIX) + 1);
+  sprintf(name, "%s%s", fileName, INTERFACE_SUFFIX);
+  return name;
+}
+
+/* A unit is in the directory of its importer, in a file named after
+   it in lower case, or else as it is written */
+char* unitFileName(char *importer, char *unitName) {
+  char *slash = (importer == NULL) ? NULL : strrchr(importer, '/');
+  int dirLength = (slash == NULL) ? 0 : slash - importer + 1;
+  char *name = (char*) malloc(dirLength + strlen(unitName) + 5);
+  int i;
+
+  if (dirLength > 0)
+    memcpy(name, importer, dirLength);
+  for (i = 0; unitName[i] != '\0'; i++)
+    name[dirLength + i] = tolower((unsigned char) unitName[i]);
+  strcpy(name + dirLength + i, ".kpl");
+  if (access(name, R_OK) != 0)
+    sprintf(name + dirLength, "%s.kpl", unitName);
+  return name;
+}
+
+unsigned long long combineKey(unsigned long long key, unsigned long long part) {
+  return (key ^ part) * 1099511628211ULL;
+}
+
+/* The key of a unit starts from its source and the symbol image its
+   interface was compiled with, whose objects it may use */
+unsigned long long baseKey(unsigned long long sourceHash) {
+  if (symbolImageMapped())
+    return combineKey(sourceHash, symbolImageKey());
+  return sourceHash;
+}
+
+int ensureInterface(char *unitFile, SymbolImage **result, unsigned long long *key);
+
+/* Whether the key of image is the one its unit has now, the units it
+   imports being brought up to date first. Returns -1 if one of them
+   can't be, as the unit imports it still. */
+int upToDate(char *unitFile, unsigned long long sourceHash, SymbolImage *image, unsigned long long *key) {
+  unsigned long long importKey;
+  char *importFile;
+  int i, result;
+
+  if (image->header->sourceHash != sourceHash)
+    return 0;
+
+  *key = baseKey(sourceHash);
+  for (i = 0; i < image->header->importCount; i++) {
+    importFile = unitFileName(unitFile, image->names + image->imports[i]);
+    result = ensureInterface(importFile, NULL, &importKey);
+    free(importFile);
+    if (result != IMPORT_DONE)
+      return -1;
+    *key = combineKey(*key, importKey);
+  }
+  return *key == image->header->key;
+}
+
+/* The compilation of a unit goes on in a child process, which leaves
+   the state of this compilation as it is */
+void compileInterface(char *unitFile) {
+  pid_t pid;
+  int status;
+
+  fflush(NULL);
+  pid = fork();
+  if (pid == 0) {
+    compileImportedUnit(unitFile);
+    exit(0);
+  }
+  if (pid > 0)
+    waitpid(pid, &status, 0);
+}
+
+/* Maps the interface of a unit into *result, or only checks it if
+   result is NULL, after compiling the unit if the interface is
+   missing or out of date */
+int ensureInterface(char *unitFile, SymbolImage **result, unsigned long long *key) {
+  unsigned long long sourceHash;
+  SymbolImage *image;
+  char *interfaceName;
+  int length, i, current;
+
+  i = findVerified(unitFile);
+  if (i >= 0) {
+    *key = verifiedKeys[i];
+    if (result == NULL)
+      return IMPORT_DONE;
+    // unless another process has replaced the interface since
+    interfaceName = interfaceFileName(unitFile);
+    image = mapSymbolImage(interfaceName);
+    free(interfaceName);
+    if (image != NULL && image->header->key == *key) {
+      *result = image;
+      return IMPORT_DONE;
+    }
+    if (image != NULL)
+      unmapSymbolImage(image);
+  }
+
+  if (!hashFile(unitFile, &sourceHash, &length))
+    return IMPORT_NOT_FOUND;
+  for (i = 0; i < unitChainLength; i++)
+    if (strcmp(unitChain[i], unitFile) == 0)
+      return IMPORT_FAILED;
+  if (unitChainLength == MAX_UNIT_NESTING)
+    return IMPORT_FAILED;
+  unitChain[unitChainLength++] = unitFile;
+
+  interfaceName = interfaceFileName(unitFile);
+  image = mapSymbolImage(interfaceName);
+  current = (image == NULL) ? 0 : upToDate(unitFile, sourceHash, image, key);
+  if (current == 0) {
+    if (image != NULL)
+      unmapSymbolImage(image);
+    compileInterface(unitFile);
+    image = mapSymbolImage(interfaceName);
+    current = (image == NULL) ? 0 : upToDate(unitFile, sourceHash, image, key);
+  }
+  if (current != 1 && image != NULL) {
+    unmapSymbolImage(image);
+    image = NULL;
+  }
+  free(interfaceName);
+  unitChainLength --;
+
+  if (image == NULL)
+    return IMPORT_FAILED;
+  rememberVerified(unitFile, *key);
+  if (result != NULL)
+    *result = image;
+  else unmapSymbolImage(image);
+  return IMPORT_DONE;
+}
+
+void addImport(char *unitName, unsigned long long key) {
+  if (importCount == importCapacity) {
+    importCapacity = (importCapacity == 0) ? 8 : 2 * importCapacity;
+    importNames = (char**) realloc(importNames, importCapacity * sizeof(char*));
+    importKeys = (unsigned long long*) realloc(importKeys, importCapacity * sizeof(unsigned long long));
+  }
+  importNames[importCount] = (char*) malloc(strlen(unitName) + 1);
+  strcpy(importNames[importCount], unitName);
+  importKeys[importCount] = key;
+  importCount ++;
+}
+
+/* Declares the objects of a unit in the global scope, where they may
+   not clash with the built-in ones or those of other units */
+int importUnit(char *importer, char *unitName) {
+  char *unitFile = unitFileName(importer, unitName);
+  SymbolImage *image;
+  unsigned long long key;
+  int result = ensureInterface(unitFile, &image, &key);
+
+  free(unitFile);
+  if (result != IMPORT_DONE)
+    return result;
+
+  if (declareImage(image, symtab->globalScope))
+    addImport(unitName, key);
+  else result = IMPORT_DUPLICATE;
+  unmapSymbolImage(image);
+  return result;
+}
+
+/* Called after the unit compiled from fileName; the key is made like
+   upToDate makes it */
+int saveUnitInterface(char *fileName) {
+  Scope* unitScope = symtab->program->progAttrs.scope;
+  unsigned long long sourceHash, key;
+  char *interfaceName;
+  int length, i, ok;
+
+  if (!hashFile(fileName, &sourceHash, &length))
+    return 0;
+  key = baseKey(sourceHash);
+  for (i = 0; i < importCount; i++)
+    key = combineKey(key, importKeys[i]);
+
+  interfaceName = interfaceFileName(fileName);
+  ok = writeSymbolImage(interfaceName, NULL, NULL, unitScope->objList, sourceHash, key, importNames, importCount);
+  free(interfaceName);
+  return ok;
+}
+
+void cleanImports(void) {
+  int i;
+
+  for (i = 0; i < importCount; i++)
+    free(importNames[i]);
+  importCount = 0;
+}
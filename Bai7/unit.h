@@ -0,0 +1,26 @@
+/* Units
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __UNIT_H__
+#define __UNIT_H__
+
+enum ImportResult {
+  IMPORT_DONE,
+  IMPORT_NOT_FOUND,
+  IMPORT_FAILED,
+  IMPORT_DUPLICATE
+};
+
+/* The constants, types, functions and procedures declared by a unit
+   are saved in its interface, fileName.kpi, a symbol image keyed by a
+   hash of the unit's source and of the keys of the units it imports.
+   An import maps the interface, compiling the unit again only when
+   the key has changed. */
+int importUnit(char *importer, char *unitName);
+int saveUnitInterface(char *fileName);
+void cleanImports(void);
+
+#endif